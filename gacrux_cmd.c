@@ -11,15 +11,19 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include "gacrux_cmd.h"
 #include "host_if.h"
+#include "host_if_bs.h"
 #include "host_if_fctry.h"
 #include "gacrux_protocol_def.h"
+#include "gacrux_upload.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -33,6 +37,7 @@
 
 #define TX_FW_ONE_PACKET_SZ (2048)
 #define BIN_INPUT_ONE_PACKET_SZ (500)
+#define BIN_INPUT_DIR "/mnt/spif/"
 
 /* Function macro */
 
@@ -56,23 +61,23 @@ do                                          \
       }                                     \
   } while(0)
 
-                                            /* If correct total size is 4, */
-#define TOTAL_PKT_NUM_TYPE_NORMAL       (0) /* 4, 4, 4, 4      */
-#define TOTAL_PKT_NUM_TYPE_ZERO         (1) /* 0, 0, 0, 0      */
-#define TOTAL_PKT_NUM_TYPE_INVALID      (2) /* 5, 5, 5, 5      */
-#define TOTAL_PKT_NUM_TYPE_SHIFT_PLUS   (3) /* 4, 4, 3, 3      */
-#define TOTAL_PKT_NUM_TYPE_SHIFT_MINUS  (4) /* 4, 4, 5, 5      */
-#define TOTAL_PKT_NUM_TYPE_MAX          (TOTAL_PKT_NUM_TYPE_SHIFT_MINUS)
-
-#define PKT_NO_TYPE_NORMAL              (0) /* 1, 2, 3, 4      */
-#define PKT_NO_TYPE_INCREMENT_FROM_ZERO (1) /* 0, 1, 2, 3      */
-#define PKT_NO_TYPE_NO_INCREMENT        (2) /* 1, 1, 1, 1      */
-#define PKT_NO_TYPE_OVER_INCREMENT      (3) /* 1, 3, 5, 7      */
-#define PKT_NO_TYPE_OVER_TOTAL_NUM      (4) /* 1, 2, 3, 4, "5" */
-#define PKT_NO_TYPE_MAX                 (PKT_NO_TYPE_OVER_TOTAL_NUM)
-
 #define WAKE_UP_PKT_SIZE                (64)
 
+/* The larger of UARTCONF and I2CCONF */
+
+#define LINKCONF_CMD_SIZE_MAX           (UARTCONF_CMD_SIZE)
+
+/* SPI clock training. Each clock has to pass a burst of SPICONF
+ * round trips, then the clock is taken the margin below the fastest.
+ */
+
+#define SPI_TRAIN_BURST (8)
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_TRAIN_MARGIN
+#  define SPI_TRAIN_MARGIN CONFIG_EXAMPLES_GHIFP_SPI_TRAIN_MARGIN
+#else
+#  define SPI_TRAIN_MARGIN (1)
+#endif
+
  /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -83,6 +88,36 @@ enum gacrux_status_e {
   GACRUX_STATUS_DEEPSLEEP,
 };
 
+/* One target of parallel TXFW, each has its own buffers. */
+
+struct parallel_target_s
+{
+  enum host_if_fctry_type_e type;
+  FAR struct host_if_s      *host;
+  FAR const char            *fw_path;
+  pthread_t                 thread;
+  bool                      running;
+  struct gacrux_upload_s    upload;
+  int                       ret;
+};
+
+/* Speed change command of a link, switched by linkconf_switch() and
+ * verified or rolled back. conf[0] is the speed No. given to set_req,
+ * the rest is up to cmd_create and prepare.
+ */
+
+struct linkconf_s
+{
+  FAR const char *name;
+  uint32_t       cmd_sz;
+  int            (*cmd_create)(FAR uint8_t *buf, uint32_t buf_len,
+                               FAR const uint8_t *conf);
+  int            (*res_check)(uint8_t *res, uint32_t res_len);
+  int            (*prepare)(FAR struct host_if_s *host,
+                            FAR const uint8_t *conf); /* May be NULL */
+  uint32_t       set_req;
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -96,6 +131,13 @@ static sem_t                     g_chgstat_evt_sem;
 
 static uint16_t                  g_tx_fw_one_packet_sz = TX_FW_ONE_PACKET_SZ;
 static uint16_t                  g_bin_input_one_packet_sz = BIN_INPUT_ONE_PACKET_SZ;
+static uint8_t                   g_tx_comp = COMPCONF_OPR_NONE;
+static struct gacrux_upload_s    g_upload;
+
+static FAR const char *g_hif_name[HOST_IF_FCTRY_TYPE_NUM] =
+{
+  "UART", "I2C", "SPI"
+};
 
 static uint8_t wake[WAKE_UP_PKT_SIZE] = {
   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
@@ -118,9 +160,11 @@ static int calc_file_sz(FAR const char *file_path);
 static int wait_chgstat_evt(void);
 static int chgstat_cmd_create(uint8_t *buf, uint32_t buf_len, int stat);
 static int chgstat_evt_hander(uint8_t notification);
-static int tx_fw_res_check(uint8_t *res, uint32_t res_len);
 static int execute_fw_cmd_create(uint8_t *buf, uint32_t buf_len);
 static int execute_fw_res_check(uint8_t *res, uint32_t res_len);
+static int execute_fw(FAR struct host_if_s *host,
+                      FAR uint8_t *recv, uint32_t recv_sz);
+static FAR void *parallel_tx_fw_thread(FAR void *arg);
 static int uartconf_cmd_create(uint8_t *buf, uint32_t buf_len,
                                uint8_t baudrate, uint8_t flow_ctrl);
 static int uartconf_res_check(uint8_t *res, uint32_t res_len);
@@ -129,16 +173,44 @@ static int i2cconf_cmd_create(uint8_t *buf, uint32_t buf_len,
 static int cmd_create(uint8_t *buf, uint8_t bin_cmd, uint8_t *opr,
                                uint16_t opr_len);
 static int i2cconf_res_check(uint8_t *res, uint32_t res_len);
+static int uartconf_build(FAR uint8_t *buf, uint32_t buf_len,
+                          FAR const uint8_t *conf);
+static int uartconf_prepare(FAR struct host_if_s *host,
+                            FAR const uint8_t *conf);
+static int i2cconf_build(FAR uint8_t *buf, uint32_t buf_len,
+                         FAR const uint8_t *conf);
+static int linkconf_switch(FAR const struct linkconf_s *lc,
+                           FAR struct host_if_s *host,
+                           FAR const uint8_t *conf, bool apply,
+                           FAR bool *written);
+static int linkconf_verify(FAR const struct linkconf_s *lc,
+                           FAR struct host_if_s *host,
+                           FAR const uint8_t *conf);
+static int linkconf_rollback(FAR const struct linkconf_s *lc,
+                             FAR struct host_if_s *host,
+                             FAR const uint8_t *conf);
 static int spiconf_cmd_create(uint8_t *buf, uint32_t buf_len,
                               uint8_t dfs);
 static int spiconf_res_check(uint8_t *res, uint32_t res_len);
+static int spiclk_set(FAR struct host_if_s *host, uint8_t clk_no);
+static int spiclk_probe(FAR struct host_if_s *host, uint8_t dfs);
+static void spiclk_auto_train(void);
 static void gacrux_cmd_evt_handler(FAR uint8_t *dataframe, int32_t len);
-static int bin_input_res_check(uint8_t *res, uint32_t res_len);
+static int compconf_cmd_create(uint8_t *buf, uint32_t buf_len,
+                               uint8_t codec);
+static int compconf_res_check(uint8_t *res, uint32_t res_len);
+static int chunkconf_cmd_create(uint8_t *buf, uint32_t buf_len,
+                                uint16_t size);
+static int chunkconf_res_check(uint8_t *res, uint32_t res_len);
+static gacrux_upload_stat_cb_t upload_stat_cb(void);
+static int upload_run(FAR const struct gacrux_upload_pktzr_s *pktzr,
+                      FAR struct gacrux_upload_src_s *src,
+                      uint16_t div_sz, uint8_t comp);
 
 static int8_t OprLength[160] = {
     [0x00] = 1, [0x01] = -1, [0x02] = 0, [0x03] = 2, [0x04] = 1,
     [0x05] = 1, [0x06] = 0, [0x07] = -1, [0x08] = 3, [0x09] = 3,
-    [0x0a] = -99, [0x0b] = 2, [0x0c] = -99, [0x0d] = -99, [0x0e] = -99,
+    [0x0a] = -99, [0x0b] = 2, [0x0c] = 1, [0x0d] = -99, [0x0e] = -99,
     [0x0f] = -99,
     [0x10] = 1, [0x11] = 2, [0x12] = 4, [0x13] = 0, [0x14] = 0,
     [0x15] = 1, [0x16] = 2, [0x17] = 4, [0x18] = 4, [0x19] = -99,
@@ -174,6 +246,26 @@ static int8_t OprLength[160] = {
     [0x9f] = -99,
 };
 
+static const struct linkconf_s g_linkconf_uart =
+{
+  .name       = "UART",
+  .cmd_sz     = UARTCONF_CMD_SIZE,
+  .cmd_create = uartconf_build,
+  .res_check  = uartconf_res_check,
+  .prepare    = uartconf_prepare,
+  .set_req    = HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
+};
+
+static const struct linkconf_s g_linkconf_i2c =
+{
+  .name       = "I2C",
+  .cmd_sz     = I2CCONF_CMD_SIZE,
+  .cmd_create = i2cconf_build,
+  .res_check  = i2cconf_res_check,
+  .prepare    = NULL,
+  .set_req    = HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -320,76 +412,6 @@ static int chgstat_evt_hander(uint8_t notification)
   return ret;
 }
 
-static int tx_fw_res_check(uint8_t *res, uint32_t res_len)
-{
-  int ret = 0;
-
-  if (res_len == TXFW_RES_SIZE)
-    {
-      if (res[GHIFP_OPC_OFFSET] != TXFW_OPC)
-        {
-          /* OPC check */
-          printf("Unexpected OPC:0x%02X\n", res[GHIFP_OPC_OFFSET]);
-          ret = -EIO;
-          goto errout;
-        }
-
-      if (res[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
-        {
-          /* Error code check */
-          printf("OPR error:%d\n", (int8_t)res[GHIFP_OPR_OFFSET]);
-          ret = (int8_t)-res[GHIFP_OPR_OFFSET];
-          goto errout;
-        }
-
-      printf("Transmit FW result:%d\n", res[GHIFP_OPR_OFFSET]);
-    }
-  else
-    {
-      printf("Unexpected res_len:%ld\n", res_len);
-      ret = -EIO;
-      goto errout;
-    }
-
-errout:
-  return ret;
-}
-
-static int bin_input_res_check(uint8_t *res, uint32_t res_len)
-{
-  int ret = 0;
-
-  if (res_len == 4+1+4+1)
-    {
-      if (res[GHIFP_OPC_OFFSET] != 0x07)
-        {
-          /* OPC check */
-          printf("Unexpected OPC:0x%02X\n", res[GHIFP_OPC_OFFSET]);
-          ret = -EIO;
-          goto errout;
-        }
-
-      if (res[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
-        {
-          /* Error code check */
-          printf("OPR error:%d\n", (int8_t)res[GHIFP_OPR_OFFSET]);
-          ret = (int8_t)-res[GHIFP_OPR_OFFSET];
-          goto errout;
-        }
-
-      printf("Transmit FW result:%d\n", res[GHIFP_OPR_OFFSET]);
-    }
-  else
-    {
-      printf("Unexpected res_len:%ld\n", res_len);
-      ret = -EIO;
-      goto errout;
-    }
-
-errout:
-  return ret;
-}
-
 static int execute_fw_cmd_create(uint8_t *buf, uint32_t buf_len)
 {
   if (!buf || buf_len < EXECFW_CMD_SIZE)
@@ -575,6 +597,161 @@ errout:
   return ret;
 }
 
+static int uartconf_build(FAR uint8_t *buf, uint32_t buf_len,
+                          FAR const uint8_t *conf)
+{
+  return uartconf_cmd_create(buf, buf_len, conf[0], conf[1]);
+}
+
+/* Flow control is switched together with the baudrate, so check the
+ * host can do it before asking Gacrux.
+ */
+
+static int uartconf_prepare(FAR struct host_if_s *host,
+                            FAR const uint8_t *conf)
+{
+  int ret;
+
+  ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETFLOWCTRL,
+                         (void *)&conf[1]);
+  if (ret < 0)
+    {
+      printf("Change flow control error:%d\n", ret);
+    }
+
+  return ret;
+}
+
+static int i2cconf_build(FAR uint8_t *buf, uint32_t buf_len,
+                         FAR const uint8_t *conf)
+{
+  return i2cconf_cmd_create(buf, buf_len, conf[0]);
+}
+
+/* Send the command with the current speed and receive the response with
+ * the new one. The host switches as soon as the command has left the
+ * wire, Gacrux changes after the command.
+ */
+
+static int linkconf_switch(FAR const struct linkconf_s *lc,
+                           FAR struct host_if_s *host,
+                           FAR const uint8_t *conf, bool apply,
+                           FAR bool *written)
+{
+  int      ret;
+  uint8_t  cmd[LINKCONF_CMD_SIZE_MAX] = {0};
+  uint32_t res_len;
+
+  *written = false;
+
+  ret = lc->cmd_create(cmd, lc->cmd_sz, conf);
+  if (ret != 0)
+    {
+      printf("Cmd create error:%d\n", ret);
+      return ret;
+    }
+
+  if (apply && lc->prepare)
+    {
+      ret = lc->prepare(host, conf);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  /* Send command by old configuration */
+  ret = host->write(host, cmd, lc->cmd_sz);
+  if (ret < 0)
+    {
+      printf("Write error:%d\n", ret);
+      return ret;
+    }
+
+  *written = true;
+
+  if (!apply)
+    {
+      printf("Invalid OPR, Not change the internal setting.\n");
+    }
+  else
+    {
+      /* Apply new configuration after TX is drained */
+      ret = host->set_config(host, lc->set_req, (void *)&conf[0]);
+      if (ret < 0)
+        {
+          printf("Change speed error:%d\n", ret);
+        }
+      else
+        {
+          printf("Apply new configuration.\n");
+        }
+    }
+
+  /* Read response by new configuration */
+  ret = host->read(host, g_recv_buff, RECV_BUFF_SZ);
+  if (ret < 0)
+    {
+      printf("Read error:%d\n", ret);
+      return ret;
+    }
+
+  res_len = ret;
+
+  return lc->res_check(g_recv_buff, res_len);
+}
+
+/* Ping with the configuration in use, so nothing changes. */
+
+static int linkconf_verify(FAR const struct linkconf_s *lc,
+                           FAR struct host_if_s *host,
+                           FAR const uint8_t *conf)
+{
+  int      ret;
+  uint8_t  cmd[LINKCONF_CMD_SIZE_MAX] = {0};
+  uint32_t res_len;
+
+  ret = lc->cmd_create(cmd, lc->cmd_sz, conf);
+  if (ret != 0)
+    {
+      return ret;
+    }
+
+  ret = host->transaction(host, cmd, lc->cmd_sz,
+                          g_recv_buff, RECV_BUFF_SZ, &res_len);
+  if (ret != 0)
+    {
+      printf("Verify error:%d\n", ret);
+      return ret;
+    }
+
+  return lc->res_check(g_recv_buff, res_len);
+}
+
+/* Gacrux may or may not have switched, so go back with the command sent
+ * by the new speed and check the old configuration works again.
+ */
+
+static int linkconf_rollback(FAR const struct linkconf_s *lc,
+                             FAR struct host_if_s *host,
+                             FAR const uint8_t *conf)
+{
+  int  ret;
+  bool written;
+
+  printf("Roll back to speed No.%d\n", conf[0]);
+
+  linkconf_switch(lc, host, conf, true, &written);
+
+  ret = linkconf_verify(lc, host, conf);
+  if (ret != 0)
+    {
+      printf("Rollback failed:%d, %s state is unknown.\n", ret, lc->name);
+    }
+
+  return ret;
+}
+
 static int spiconf_cmd_create(uint8_t *buf, uint32_t buf_len,
                               uint8_t dfs)
 {
@@ -630,73 +807,323 @@ errout:
   return ret;
 }
 
-static void gacrux_cmd_evt_handler(FAR uint8_t *dataframe, int32_t len)
+static int spiclk_set(FAR struct host_if_s *host, uint8_t clk_no)
 {
-  int      ret;
-  uint8_t  opc;
-  uint16_t opr_len;
+  char arg[4];
 
-  printf("Get event.\n");
+  snprintf(arg, sizeof(arg), "%u", clk_no);
 
-  if (!dataframe || len < GHIFP_HEADER_SIZE)
-    {
-      return;
-    }
+  return host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETSPICLK, arg);
+}
 
-  ret = check_header(dataframe, &opc, &opr_len);
+/* SPICONF with the DFS in use changes nothing on Gacrux, its frames are
+ * checksum-verified by the receive task.
+ */
+
+static int spiclk_probe(FAR struct host_if_s *host, uint8_t dfs)
+{
+  int      ret;
+  int      i;
+  uint8_t  cmd[SPICONF_CMD_SIZE] = {0};
+  uint32_t res_len;
+
+  ret = spiconf_cmd_create(cmd, SPICONF_CMD_SIZE, dfs);
   if (ret != 0)
     {
-      return;
+      return ret;
     }
-  printf("opc:0x%02X\n", opc);
 
-  ret = check_data(dataframe + GHIFP_HEADER_SIZE, opr_len);
-  if (ret != 0)
+  for (i=0; i<SPI_TRAIN_BURST; i++)
     {
-      return;
+      ret = host->transaction(host, cmd, SPICONF_CMD_SIZE,
+                              g_recv_buff, RECV_BUFF_SZ, &res_len);
+      if (ret != 0)
+        {
+          return ret;
+        }
+
+      if (res_len != SPICONF_RES_SIZE ||
+          g_recv_buff[GHIFP_OPC_OFFSET] != SPICONF_OPC ||
+          g_recv_buff[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
+        {
+          return -EIO;
+        }
     }
 
-  switch (opc)
+  return 0;
+}
+
+static void spiclk_auto_train(void)
+{
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_TRAIN
+  if (g_hif_type == HOST_IF_FCTRY_TYPE_SPI)
     {
-      // case CHGSTAT_OPC:
-      //   if (opr_len < CHGSTAT_RES_SIZE)
-      //     {
-      //       chgstat_evt_hander(dataframe[GHIFP_OPR_OFFSET]);
-      //     }
-      //   else
-      //     {
-      //       printf("Unexpected opr_len:%d\n", opr_len);
-      //     }
-      //   break;
-      case FRAMECHKERR_OPC:
-        printf("Data frame error.\n");
-        if (opr_len == FRAMECHKERR_OPR_SIZE)
-          {
-            printf("Error notification, OPC      :0x%02X\n",
-              dataframe[FRAMECHKERR_OPR1_OFFSET]);
-            printf("Error notification, ErrorCode:0x%02X\n",
-              dataframe[FRAMECHKERR_OPR2_OFFSET]);
-          }
-        else
-          {
-            printf("Unexpected opr_len:%d\n", opr_len);
-          }
-        break;
-      default:
-        break;
+      gacrux_cmd_spiclk_train();
     }
-  return;
+#endif
 }
 
-/****************************************************************************
- * Public Functions
- ****************************************************************************/
-
-int gacrux_cmd_init(void)
+static int compconf_cmd_create(uint8_t *buf, uint32_t buf_len,
+                               uint8_t codec)
 {
-  int ret;
+  if (!buf || buf_len < COMPCONF_CMD_SIZE)
+    {
+      return -EINVAL;
+    }
 
-  CHECKUNINIT();
+  buf[GHIFP_SYNC_OFFSET]       = GHIFP_SYNC;
+  *(uint16_t *)&buf[GHIFP_OPR_LEN_OFFSET] = COMPCONF_OPR_SIZE; /* Set OPC len by little endian. */
+  buf[GHIFP_OPC_OFFSET]        = COMPCONF_OPC;
+  buf[GHIFP_H_CHECKSUM_OFFSET] = calc_checksum(buf, 4);
+  buf[GHIFP_OPR_OFFSET]        = codec;
+  buf[GHIFP_D_CHECKSUM_OFFSET(COMPCONF_OPR_SIZE)]
+                               = calc_checksum(&buf[GHIFP_OPR_OFFSET],
+                                               COMPCONF_OPR_SIZE);
+
+  return 0;
+}
+
+static int compconf_res_check(uint8_t *res, uint32_t res_len)
+{
+  int ret = 0;
+
+  if (res_len == COMPCONF_RES_SIZE)
+    {
+      if (res[GHIFP_OPC_OFFSET] != COMPCONF_OPC)
+        {
+          /* OPC check */
+          printf("Unexpected OPC:0x%02X\n", res[GHIFP_OPC_OFFSET]);
+          ret = -EIO;
+          goto errout;
+        }
+
+      if (res[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
+        {
+          /* Error code check */
+          printf("OPR error:%d\n", (int8_t)res[GHIFP_OPR_OFFSET]);
+          ret = (int8_t)-res[GHIFP_OPR_OFFSET];
+          goto errout;
+        }
+
+      printf("Change compression configuration result:%d\n",
+             res[GHIFP_OPR_OFFSET]);
+    }
+  else
+    {
+      printf("Unexpected res_len:%ld\n", res_len);
+      ret = -EIO;
+      goto errout;
+    }
+
+errout:
+  return ret;
+}
+
+static int chunkconf_cmd_create(uint8_t *buf, uint32_t buf_len,
+                                uint16_t size)
+{
+  if (!buf || buf_len < CHUNKCONF_CMD_SIZE)
+    {
+      return -EINVAL;
+    }
+
+  buf[GHIFP_SYNC_OFFSET]       = GHIFP_SYNC;
+  *(uint16_t *)&buf[GHIFP_OPR_LEN_OFFSET] = CHUNKCONF_OPR_SIZE; /* Set OPC len by little endian. */
+  buf[GHIFP_OPC_OFFSET]        = CHUNKCONF_OPC;
+  buf[GHIFP_H_CHECKSUM_OFFSET] = calc_checksum(buf, 4);
+  *(uint16_t *)&buf[GHIFP_OPR_OFFSET] = size;
+  buf[GHIFP_D_CHECKSUM_OFFSET(CHUNKCONF_OPR_SIZE)]
+                               = calc_checksum(&buf[GHIFP_OPR_OFFSET],
+                                               CHUNKCONF_OPR_SIZE);
+
+  return 0;
+}
+
+static int chunkconf_res_check(uint8_t *res, uint32_t res_len)
+{
+  int ret = 0;
+
+  if (res_len == CHUNKCONF_RES_SIZE)
+    {
+      if (res[GHIFP_OPC_OFFSET] != CHUNKCONF_OPC)
+        {
+          /* OPC check */
+          printf("Unexpected OPC:0x%02X\n", res[GHIFP_OPC_OFFSET]);
+          ret = -EIO;
+          goto errout;
+        }
+
+      if (res[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
+        {
+          /* Error code check */
+          printf("OPR error:%d\n", (int8_t)res[GHIFP_OPR_OFFSET]);
+          ret = (int8_t)-res[GHIFP_OPR_OFFSET];
+          goto errout;
+        }
+
+      printf("Change chunk configuration result:%d\n",
+             res[GHIFP_OPR_OFFSET]);
+    }
+  else
+    {
+      printf("Unexpected res_len:%ld\n", res_len);
+      ret = -EIO;
+      goto errout;
+    }
+
+errout:
+  return ret;
+}
+
+static gacrux_upload_stat_cb_t upload_stat_cb(void)
+{
+  return HOST_IF_VERBOSE_PROGRESS <= host_if_get_verbose() ?
+         gacrux_upload_stat_print : NULL;
+}
+
+static int upload_run(FAR const struct gacrux_upload_pktzr_s *pktzr,
+                      FAR struct gacrux_upload_src_s *src,
+                      uint16_t div_sz, uint8_t comp)
+{
+  g_upload.host   = host_if_fctry_get_obj(g_hif_type);
+  g_upload.pktzr  = pktzr;
+  g_upload.src    = src;
+  g_upload.div_sz = div_sz;
+  g_upload.comp   = comp;
+
+  g_upload.stat_cb = upload_stat_cb();
+
+  return gacrux_upload_run(&g_upload);
+}
+
+static int execute_fw(FAR struct host_if_s *host,
+                      FAR uint8_t *recv, uint32_t recv_sz)
+{
+  int      ret;
+  uint8_t  cmd[EXECFW_CMD_SIZE] = {0};
+  uint32_t res_len;
+
+  ret = execute_fw_cmd_create(cmd, EXECFW_CMD_SIZE);
+  if (ret != 0)
+    {
+      printf("Cmd create error:%d\n", ret);
+      goto exit;
+    }
+
+  ret = host->transaction(host, cmd, EXECFW_CMD_SIZE,
+                          recv, recv_sz, &res_len);
+  if (ret != 0)
+    {
+      printf("Transaction error:%d\n", ret);
+      goto exit;
+    }
+
+  ret = execute_fw_res_check(recv, res_len);
+
+exit:
+  return ret;
+}
+
+static FAR void *parallel_tx_fw_thread(FAR void *arg)
+{
+  FAR struct parallel_target_s *t = (FAR struct parallel_target_s *)arg;
+  struct gacrux_upload_src_s   src;
+
+  t->ret = gacrux_upload_src_file(&src, t->fw_path);
+  if (t->ret < 0)
+    {
+      return NULL;
+    }
+
+  t->upload.host   = t->host;
+  t->upload.pktzr  = &g_upload_pktzr_txfw;
+  t->upload.src    = &src;
+  t->upload.div_sz = g_tx_fw_one_packet_sz;
+  t->upload.comp   = COMPCONF_OPR_NONE;
+
+  t->upload.stat_cb  = upload_stat_cb();
+  t->upload.stat_arg = (FAR void *)g_hif_name[t->type];
+
+  t->ret = gacrux_upload_run(&t->upload);
+
+  gacrux_upload_src_close(&src);
+
+  if (t->ret == 0)
+    {
+      t->ret = execute_fw(t->upload.host, t->upload.recv,
+                          t->upload.recv_sz);
+    }
+
+  return NULL;
+}
+
+static void gacrux_cmd_evt_handler(FAR uint8_t *dataframe, int32_t len)
+{
+  int      ret;
+  uint8_t  opc;
+  uint16_t opr_len;
+
+  printf("Get event.\n");
+
+  if (!dataframe || len < GHIFP_HEADER_SIZE)
+    {
+      return;
+    }
+
+  ret = check_header(dataframe, &opc, &opr_len);
+  if (ret != 0)
+    {
+      return;
+    }
+  printf("opc:0x%02X\n", opc);
+
+  ret = check_data(dataframe + GHIFP_HEADER_SIZE, opr_len);
+  if (ret != 0)
+    {
+      return;
+    }
+
+  switch (opc)
+    {
+      // case CHGSTAT_OPC:
+      //   if (opr_len < CHGSTAT_RES_SIZE)
+      //     {
+      //       chgstat_evt_hander(dataframe[GHIFP_OPR_OFFSET]);
+      //     }
+      //   else
+      //     {
+      //       printf("Unexpected opr_len:%d\n", opr_len);
+      //     }
+      //   break;
+      case FRAMECHKERR_OPC:
+        printf("Data frame error.\n");
+        if (opr_len == FRAMECHKERR_OPR_SIZE)
+          {
+            printf("Error notification, OPC      :0x%02X\n",
+              dataframe[FRAMECHKERR_OPR1_OFFSET]);
+            printf("Error notification, ErrorCode:0x%02X\n",
+              dataframe[FRAMECHKERR_OPR2_OFFSET]);
+          }
+        else
+          {
+            printf("Unexpected opr_len:%d\n", opr_len);
+          }
+        break;
+      default:
+        break;
+    }
+  return;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int gacrux_cmd_init(void)
+{
+  int ret;
+
+  CHECKUNINIT();
 
   ret = sem_init(&g_chgstat_evt_sem, 0, 0);
   if (ret < 0)
@@ -717,7 +1144,9 @@ int gacrux_cmd_init(void)
   ret = host_if_fctry_init(gacrux_cmd_evt_handler);
   if (ret == 0)
     {
+      gacrux_upload_init(&g_upload, g_recv_buff, RECV_BUFF_SZ);
       g_is_cmd_init = true;
+      spiclk_auto_train();
     }
   else
     {
@@ -742,6 +1171,8 @@ int gacrux_cmd_deinit(void)
       goto errout;
     }
 
+  gacrux_upload_fin(&g_upload);
+
   if (g_recv_buff)
     {
       free((FAR void *)g_recv_buff);
@@ -755,6 +1186,7 @@ int gacrux_cmd_deinit(void)
     }
 
   g_is_cmd_init = false;
+  g_tx_comp     = COMPCONF_OPR_NONE;
 
 errout:
   return ret;
@@ -804,16 +1236,8 @@ exit:
 
 int gacrux_cmd_tx_fw(const char *fw_path)
 {
-  int                  ret;
-  int                  i;
-  int                  fd;
-  FAR struct host_if_s *host;
-  FAR uint8_t          *cmd = NULL;
-  int                  loop_num;
-  uint32_t             pkt_len;
-  uint32_t             total_tx_len = 0;
-  int32_t              file_sz;
-  uint32_t             res_len;
+  int                        ret;
+  struct gacrux_upload_src_s src;
 
   CHECKINIT();
 
@@ -822,137 +1246,156 @@ int gacrux_cmd_tx_fw(const char *fw_path)
     return -EINVAL;
     }
 
-  file_sz = calc_file_sz(fw_path);
-  if (file_sz < 0)
+  ret = gacrux_upload_src_file(&src, fw_path);
+  if (ret < 0)
     {
-      return file_sz;
+      return ret;
     }
 
-  printf("Division size = %d\n", g_tx_fw_one_packet_sz);
+  ret = gacrux_cmd_tx_fw_src(&src);
 
-  loop_num =
-    (file_sz % g_tx_fw_one_packet_sz) == 0 ?
-    (file_sz / g_tx_fw_one_packet_sz) : (file_sz / g_tx_fw_one_packet_sz) + 1;
-  printf("loop_num:%d\n", loop_num);
+  gacrux_upload_src_close(&src);
 
-  fd = open(fw_path, O_RDONLY);
-  if (fd < 0)
+  return ret;
+}
+
+int gacrux_cmd_tx_fw_src(FAR struct gacrux_upload_src_s *src)
+{
+  CHECKINIT();
+
+  if (!src)
     {
-      printf("Failed to open FW file.\n");
-      return fd;
+      return -EINVAL;
     }
 
-  cmd = malloc(TXFW_CMD_SIZE(g_tx_fw_one_packet_sz));
-  if (!cmd)
+  return upload_run(&g_upload_pktzr_txfw, src, g_tx_fw_one_packet_sz,
+                    g_tx_comp);
+}
+
+int gacrux_cmd_execute_fw(void)
+{
+  CHECKINIT();
+
+  return execute_fw(host_if_fctry_get_obj(g_hif_type),
+                    g_recv_buff, RECV_BUFF_SZ);
+}
+
+int gacrux_cmd_uartconf(uint8_t baudrate, uint8_t flow_ctrl)
+{
+  int                  ret;
+  bool                 apply;
+  bool                 written;
+  uint8_t              conf[2]; /* Speed No, flow control */
+  uint8_t              old[2];
+  FAR struct host_if_s *host;
+
+  CHECKINIT();
+
+  if (g_hif_type != HOST_IF_FCTRY_TYPE_UART)
     {
-      printf("Failed to allocate divided FW buf.\n");
-      ret = -errno;
-      goto exit;
+      printf("Permitted to execute only when selecting UART mode.\n");
+      return -EPERM;
     }
 
-  host = host_if_fctry_get_obj(g_hif_type);
+  printf("baudrate:0x%02X, flow_ctrl:0x%02X\n",
+         baudrate, flow_ctrl);
 
-  for (i=0; i<loop_num; i++)
+  if (baudrate == SPEED_UART_14400BPS ||
+      SPEED_UART_MAX < baudrate)
     {
-      pkt_len = g_tx_fw_one_packet_sz < (file_sz - total_tx_len) ?
-                g_tx_fw_one_packet_sz : (file_sz - total_tx_len);
+      printf("Warning!! Unsupported configuration. Behavior is undefined.\n");
+    }
 
-      /* ++ Create command ++ */
-      cmd[GHIFP_SYNC_OFFSET]                           = GHIFP_SYNC;
-      *(uint16_t *)&cmd[GHIFP_OPR_LEN_OFFSET]          = TXFW_OPR_SIZE(pkt_len); /* Set OPC len by little endian. */
-      cmd[GHIFP_OPC_OFFSET]                            = TX_BIN_OPC;
-      cmd[GHIFP_H_CHECKSUM_OFFSET]                     = calc_checksum(cmd, 4);
-      *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = loop_num;
-      *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET]       = i+1;
+  host = host_if_fctry_get_obj(g_hif_type);
 
-      ret = read(fd, &cmd[TXFW_OPR_PKT_OFFSET], pkt_len);
+  /* The UART host keeps the settings in use, auto-baud may change them. */
 
-      if (ret != pkt_len)
-        {
-          printf("File read error. len:%u expected len:%lu\n", ret, pkt_len);
-          ret = -EIO;
-          break;
-        }
-      total_tx_len += ret;
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, old);
 
-      cmd[GHIFP_D_CHECKSUM_OFFSET(TXFW_OPR_SIZE(pkt_len))] =
-        calc_checksum(&cmd[GHIFP_OPR_OFFSET], TXFW_OPR_SIZE(pkt_len));
+  /* Invalid OPR is still sent to test the error response of Gacrux. */
 
-      /* -- Create command -- */
+  apply = !(UARTCONF_OPR1_10000000BPS < baudrate ||
+            UARTCONF_OPR2_FLOW_CTRL_ON < flow_ctrl);
 
-      printf("Packet(%d/%d) fw part size:%ld\n", i+1, loop_num, pkt_len);
+  conf[0] = baudrate;
+  conf[1] = flow_ctrl;
 
-      ret = host->transaction(host, cmd, TXFW_CMD_SIZE(pkt_len),
-                              g_recv_buff, RECV_BUFF_SZ, &res_len);
-      if (ret != 0)
-        {
-          printf("Transaction error:%d\n", ret);
-          break;
-        }
-
-      ret = tx_fw_res_check(g_recv_buff, res_len);
-      if (ret != 0)
-        {
-          printf("Transaction error:%d\n", ret);
-          break;
-        }
+  ret = linkconf_switch(&g_linkconf_uart, host, conf, apply, &written);
+  if (!apply || !written)
+    {
+      return ret;
     }
 
-    if (ret == 0)
-      {
-        printf("Completed all transfers!!\n");
-      }
-
-exit:
-
-  close(fd);
+  if (ret == 0)
+    {
+      ret = linkconf_verify(&g_linkconf_uart, host, conf);
+    }
 
-  if (cmd)
+  if (ret == 0)
     {
-      free(cmd);
+      printf("UART speed No.%d -> No.%d, flow control %s verified.\n",
+             old[0], baudrate, flow_ctrl ? "ON" : "OFF");
+    }
+  else
+    {
+      linkconf_rollback(&g_linkconf_uart, host, old);
     }
 
   return ret;
 }
 
-int gacrux_cmd_execute_fw(void)
+int gacrux_cmd_uartconf_auto(uint8_t flow_ctrl)
 {
   int                  ret;
+  uint8_t              speed;
+  uint8_t              conf[2]; /* Speed No, flow control */
   FAR struct host_if_s *host;
-  uint8_t              cmd[EXECFW_CMD_SIZE] = {0};
-  uint32_t             res_len;
 
   CHECKINIT();
 
+  if (g_hif_type != HOST_IF_FCTRY_TYPE_UART)
+    {
+      printf("Permitted to execute only when selecting UART mode.\n");
+      return -EPERM;
+    }
+
   host = host_if_fctry_get_obj(g_hif_type);
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, conf);
 
-  ret = execute_fw_cmd_create(cmd, EXECFW_CMD_SIZE);
-  if (ret != 0)
+  /* Step up one rate at a time, a failed one is rolled back. */
+
+  for (speed=conf[0]+1; speed<=SPEED_UART_MAX; speed++)
     {
-      printf("Cmd create error:%d\n", ret);
-      goto exit;
+      if (speed == SPEED_UART_14400BPS)
+        {
+          continue;
+        }
+
+      ret = gacrux_cmd_uartconf(speed, flow_ctrl);
+      if (ret != 0)
+        {
+          break;
+        }
     }
 
-  ret = host->transaction(host, cmd, EXECFW_CMD_SIZE,
-                          g_recv_buff, RECV_BUFF_SZ, &res_len);
-  if (ret != 0)
+  /* The last failure is expected, only the link in use matters. */
+
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, conf);
+
+  ret = linkconf_verify(&g_linkconf_uart, host, conf);
+  if (ret == 0)
     {
-      printf("Transaction error:%d\n", ret);
-      goto exit;
+      printf("UART speed No.%d is the fastest verified.\n", conf[0]);
     }
 
-  ret = execute_fw_res_check(g_recv_buff, res_len);
-
-exit:
   return ret;
 }
 
-int gacrux_cmd_uartconf(uint8_t baudrate, uint8_t flow_ctrl)
+int gacrux_cmd_uart_resync(void)
 {
   int                  ret;
+  uint8_t              speed;
   FAR struct host_if_s *host;
-  uint8_t              cmd[UARTCONF_CMD_SIZE] = {0};
-  uint32_t             res_len;
 
   CHECKINIT();
 
@@ -962,76 +1405,24 @@ int gacrux_cmd_uartconf(uint8_t baudrate, uint8_t flow_ctrl)
       return -EPERM;
     }
 
-  printf("baudrate:0x%02X, flow_ctrl:0x%02X\n",
-         baudrate, flow_ctrl);
-
-  if (0 < flow_ctrl ||
-      baudrate == SPEED_UART_14400BPS ||
-      SPEED_UART_MAX < baudrate)
-    {
-      printf("Warning!! Unsupported configuration. Behavior is undefined.\n");
-    }
-
   host = host_if_fctry_get_obj(g_hif_type);
 
-  ret = uartconf_cmd_create(cmd, UARTCONF_CMD_SIZE, baudrate, flow_ctrl);
-  if (ret != 0)
-    {
-      printf("Cmd create error:%d\n", ret);
-      goto exit;
-    }
-
-  /* Send command by old configuration */
-  ret = host->write(host, cmd, UARTCONF_CMD_SIZE);
-  if (ret < 0)
-    {
-      printf("Write error:%d\n", ret);
-      goto exit;
-    }
-
-  usleep(20000); /* Wait completion transfer(temporary) */
-
-  if (UARTCONF_OPR1_10000000BPS < baudrate ||
-      UARTCONF_OPR2_FLOW_CTRL_ON < flow_ctrl)
-    {
-      printf("Invalid OPR, Not change the internal setting.\n");
-    }
-  else
-    {
-      /* Apply new configuration */
-      ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
-                            (void *)&baudrate);
-      if (ret < 0)
-        {
-          printf("Change baudrate error:%d\n", ret);
-        }
-      else
-        {
-          printf("Apply new configuration.\n");
-        }
-    }
-
-  /* Read response by new configuration */
-  res_len = host->read(host, g_recv_buff, RECV_BUFF_SZ);
-  if (res_len < 0)
+  ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_RESYNC, &speed);
+  if (ret == 0)
     {
-      printf("Read error:%ld\n", res_len);
-      ret = res_len;
-      goto exit;
+      printf("UART speed No.%d\n", speed);
     }
 
-  ret = uartconf_res_check(g_recv_buff, res_len);
-
-exit:
   return ret;
 }
 
 int gacrux_cmd_i2cconf(uint8_t speed)
 {
   int                  ret;
+  bool                 apply;
+  bool                 written;
+  uint8_t              old = SPEED_I2C_1000000BPS;
   FAR struct host_if_s *host;
-  uint8_t              cmd[I2CCONF_CMD_SIZE] = {0};
-  int                  res_len;
 
   CHECKINIT();
 
@@ -1049,54 +1440,32 @@ int gacrux_cmd_i2cconf(uint8_t speed)
     }
 
   host = host_if_fctry_get_obj(g_hif_type);
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, &old);
 
-  ret = i2cconf_cmd_create(cmd, I2CCONF_CMD_SIZE, speed);
-  if (ret != 0)
+  /* Invalid OPR is still sent to test the error response of Gacrux. */
+
+  apply = !(I2CCONF_OPR_3400000BPS < speed);
+
+  ret = linkconf_switch(&g_linkconf_i2c, host, &speed, apply, &written);
+  if (!apply || !written)
     {
-      printf("Cmd create error:%d\n", ret);
-      goto exit;
+      return ret;
     }
 
-  /* Send command by old configuration */
-  ret = host->write(host, cmd, I2CCONF_CMD_SIZE);
-  if (ret < 0)
+  if (ret == 0)
     {
-      printf("Write error:%d\n", ret);
-      goto exit;
+      ret = linkconf_verify(&g_linkconf_i2c, host, &speed);
     }
 
-  if (I2CCONF_OPR_3400000BPS < speed)
+  if (ret == 0)
     {
-      printf("Invalid OPR, Not change the internal setting.\n");
+      printf("I2C speed No.%d -> No.%d verified.\n", old, speed);
     }
   else
     {
-      /* Apply new configuration */
-      ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
-                            (void *)&speed);
-      if (ret < 0)
-        {
-          printf("Change speed error:%d\n", ret);
-        }
-      else
-        {
-          printf("Apply new configuration.\n");
-        }
-    }
-
-  /* Read response by new configuration */
-  res_len = host->read(host, g_recv_buff, RECV_BUFF_SZ);
-
-  if (res_len < 0)
-    {
-      printf("Read error:%d\n", res_len);
-      ret = res_len;
-      goto exit;
+      linkconf_rollback(&g_linkconf_i2c, host, &old);
     }
 
-  ret = i2cconf_res_check(g_recv_buff, res_len);
-
-exit:
   return ret;
 }
 
@@ -1165,61 +1534,155 @@ int gacrux_cmd_spiconf(uint8_t dfs)
       return -EPERM;
     }
 
-  printf("dfs:0x%02X\n", dfs);
+  printf("dfs:0x%02X\n", dfs);
+
+  if (DFS_SPI_MAX < dfs)
+    {
+      printf("Warning!! Unsupported configuration. Behavior is undefined.\n");
+    }
+
+  host = host_if_fctry_get_obj(g_hif_type);
+
+  ret = spiconf_cmd_create(cmd, SPICONF_CMD_SIZE, dfs);
+  if (ret != 0)
+    {
+      printf("Cmd create error:%d\n", ret);
+      goto exit;
+    }
+
+  /* Send command by old configuration */
+  ret = host->write(host, cmd, SPICONF_CMD_SIZE);
+  if (ret < 0)
+    {
+      printf("Write error:%d\n", ret);
+      goto exit;
+    }
+
+  if (SPICONF_OPR_DFS32 < dfs)
+    {
+      printf("Invalid OPR, Not change the internal setting.\n");
+    }
+  else
+    {
+      /* Apply new configuration */
+      ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
+                            (void *)&dfs);
+      if (ret < 0)
+        {
+          printf("Change dfs error:%d\n", ret);
+        }
+      else
+        {
+          printf("Apply new configuration.\n");
+        }
+    }
+
+  /* Read response by new configuration */
+  res_len = host->read(host, g_recv_buff, RECV_BUFF_SZ);
+  if (res_len < 0)
+    {
+      printf("Read error:%ld\n", res_len);
+      ret = res_len;
+      goto exit;
+    }
+
+  ret = spiconf_res_check(g_recv_buff, res_len);
+  if (ret == 0)
+    {
+      spiclk_auto_train();
+    }
+
+exit:
+  return ret;
+}
+
+int gacrux_cmd_spiclk_train(void)
+{
+  int                  ret;
+  int                  best = -1;
+  uint8_t              clk;
+  uint8_t              old = SPEED_SPI_2600000BPS;
+  uint8_t              dfs = DFS_SPI_8;
+  uint8_t              tc;
+  FAR struct host_if_s *host;
+
+  CHECKINIT();
+
+  if (g_hif_type != HOST_IF_FCTRY_TYPE_SPI)
+    {
+      printf("Permitted to execute only when selecting SPI mode.\n");
+      return -EPERM;
+    }
+
+  host = host_if_fctry_get_obj(g_hif_type);
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, &dfs);
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSPICLK, &old);
+
+  /* The clock is for bulk transfers, so probe it as one. */
+
+  tc = HOST_IF_CLASS_BULK;
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETCLASS, &tc);
+
+  /* Step up from the slowest, stop at the first clock with an error.
+   * A clock the host cannot set is an error too, the probe would run at
+   * the previous one.
+   */
+
+  for (clk=SPEED_SPI_1300000BPS; clk<=SPEED_SPI_MAX; clk++)
+    {
+      ret = spiclk_set(host, clk);
+      if (ret < 0)
+        {
+          printf("SPI clock No.%d: NG, set error:%d\n", clk, ret);
+          break;
+        }
+
+      ret = spiclk_probe(host, dfs);
+      printf("SPI clock No.%d: %s\n", clk, ret == 0 ? "OK" : "NG");
+      if (ret != 0)
+        {
+          break;
+        }
 
-  if (DFS_SPI_MAX < dfs)
-    {
-      printf("Warning!! Unsupported configuration. Behavior is undefined.\n");
+      best = clk;
     }
 
-  host = host_if_fctry_get_obj(g_hif_type);
-
-  ret = spiconf_cmd_create(cmd, SPICONF_CMD_SIZE, dfs);
-  if (ret != 0)
+  if (best < 0)
     {
-      printf("Cmd create error:%d\n", ret);
+      printf("No SPI clock works. Keep No.%d\n", old);
+      if (spiclk_set(host, old) < 0)
+        {
+          printf("Failed to restore SPI clock No.%d\n", old);
+        }
+
+      ret = -EIO;
       goto exit;
     }
 
-  /* Send command by old configuration */
-  ret = host->write(host, cmd, SPICONF_CMD_SIZE);
+  clk = (SPI_TRAIN_MARGIN < best) ? best - SPI_TRAIN_MARGIN :
+                                    SPEED_SPI_1300000BPS;
+  ret = spiclk_set(host, clk);
   if (ret < 0)
     {
-      printf("Write error:%d\n", ret);
+      printf("Failed to set SPI clock No.%d:%d\n", clk, ret);
       goto exit;
     }
 
-  if (SPICONF_OPR_DFS32 < dfs)
+  ret = spiclk_probe(host, dfs);
+  if (ret == 0)
     {
-      printf("Invalid OPR, Not change the internal setting.\n");
+      printf("SPI clock No.%d selected, No.%d is the fastest verified.\n",
+             clk, best);
     }
   else
     {
-      /* Apply new configuration */
-      ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETSLVCONF,
-                            (void *)&dfs);
-      if (ret < 0)
-        {
-          printf("Change dfs error:%d\n", ret);
-        }
-      else
-        {
-          printf("Apply new configuration.\n");
-        }
-    }
-
-  /* Read response by new configuration */
-  res_len = host->read(host, g_recv_buff, RECV_BUFF_SZ);
-  if (res_len < 0)
-    {
-      printf("Read error:%ld\n", res_len);
-      ret = res_len;
-      goto exit;
+      printf("SPI clock No.%d failed after training:%d\n", clk, ret);
     }
 
-  ret = spiconf_res_check(g_recv_buff, res_len);
-
 exit:
+  tc = HOST_IF_CLASS_CONTROL;
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETCLASS, &tc);
+
   return ret;
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -1227,6 +1690,7 @@ int gacrux_cmd_spiwrite(uint8_t bin_cmd, uint8_t *opr, uint16_t opr_len)
 {
   int ret = 0;
   FAR struct host_if_s *host;
+  uint8_t dfs = DFS_SPI_8;
 
   printf("opr_len : %d\n", opr_len);
   for (int i = 0; i < opr_len; i++) {
@@ -1254,22 +1718,24 @@ int gacrux_cmd_spiwrite(uint8_t bin_cmd, uint8_t *opr, uint16_t opr_len)
   //   ret = host->write(host, buf, GHIFP_HEADER_SIZE+GHIFP_DATA_SIZE(opr_len));
   // }
 
-  ret = host->write(host, buf, GHIFP_HEADER_SIZE);
-  up_mdelay(5);
-  if (opr_len != 0) {
-#ifdef Bit16Test
-    int send_size = GHIFP_HEADER_SIZE + GHIFP_DATA_SIZE(opr_len) - ret;
-    if (send_size) {
-      ret = host->write(host, buf + ret, send_size);
-    }
-#else
-    ret = host->write(host, buf + GHIFP_HEADER_SIZE, GHIFP_DATA_SIZE(opr_len));
-    if (bin_cmd == 0 && (opr[0] == 2)) {
-      ret = host->write(host, wake, WAKE_UP_PKT_SIZE);
+  /* With 16 or 32 bit words the header would end in a padded word, so
+   * the frame is sent at once. The SPI host keeps the gap between
+   * frames.
+   */
+
+  host->set_config(host, HOST_IF_SET_CONFIG_REQ_GETSLVCONF, &dfs);
+
+  if (dfs != DFS_SPI_8 && opr_len != 0) {
+    ret = host->write(host, buf, GHIFP_HEADER_SIZE + GHIFP_DATA_SIZE(opr_len));
+  } else {
+    ret = host->write(host, buf, GHIFP_HEADER_SIZE);
+    if (opr_len != 0) {
+      ret = host->write(host, buf + GHIFP_HEADER_SIZE, GHIFP_DATA_SIZE(opr_len));
     }
-#endif
   }
-  up_mdelay(5);
+  if (opr_len != 0 && bin_cmd == 0 && (opr[0] == 2)) {
+    ret = host->write(host, wake, WAKE_UP_PKT_SIZE);
+  }
   return ret;
 }
 
@@ -1422,6 +1888,8 @@ int gacrux_cmd_set_if_type(int if_type)
   printf("Serial I/F type is changed. %d -> %d\n", g_hif_type, if_type);
   g_hif_type = (enum host_if_fctry_type_e)if_type;
 
+  spiclk_auto_train();
+
   return 0;
 }
 
@@ -1429,10 +1897,40 @@ int gacrux_cmd_get_if_type(void){
   return g_hif_type;
 }
 
+int gacrux_cmd_set_verbose(int level)
+{
+  int ret;
+
+  ret = host_if_set_verbose(level);
+  if (ret == 0)
+    {
+      printf("Verbose level:%d\n", level);
+    }
+
+  return ret;
+}
+
+int gacrux_cmd_get_verbose(void)
+{
+  return host_if_get_verbose();
+}
+
 int gacrux_cmd_set_division_size(uint16_t sz)
 {
   CHECKINIT();
 
+  /* Compressed packets carry TXFW_COMP_HDR_SIZE more, and a stored one
+   * over the max OPC length cannot be sent at all.
+   */
+
+  if (g_tx_comp != COMPCONF_OPR_NONE &&
+      GHIFP_OPR_LEN_MAX < TXFW_OPR_SIZE(sz) + TXFW_COMP_HDR_SIZE)
+    {
+      printf("Over the max OPC length with compression. (max %d)\n",
+             GHIFP_OPR_LEN_MAX - TXFW_OPR_SIZE(0) - TXFW_COMP_HDR_SIZE);
+      return -EINVAL;
+    }
+
   printf("Division size is changed. %d -> %d\n", g_tx_fw_one_packet_sz, sz);
   g_tx_fw_one_packet_sz = sz;
 
@@ -1458,15 +1956,7 @@ int gacrux_cmd_set_config(uint32_t req, FAR void *arg)
 int gacrux_cmd_debug_tx_fw(uint32_t virtual_file_sz, uint16_t div_sz,
                            uint8_t total_pkt_type, uint8_t pkt_no_type)
 {
-  int                  ret;
-  int                  i;
-  FAR struct host_if_s *host;
-  FAR uint8_t          *cmd = NULL;
-  int                  loop_num;
-  uint32_t             pkt_len;
-  uint16_t             total_pkt_num;
-  uint32_t             total_tx_len = 0;
-  uint32_t             res_len;
+  struct gacrux_upload_src_s src;
 
   CHECKINIT();
 
@@ -1478,255 +1968,343 @@ int gacrux_cmd_debug_tx_fw(uint32_t virtual_file_sz, uint16_t div_sz,
           virtual_file_sz, div_sz, total_pkt_type, pkt_no_type);
 
   if (TOTAL_PKT_NUM_TYPE_MAX < total_pkt_type ||
-      PKT_NO_TYPE_MAX < pkt_no_type)
+      PKT_NO_TYPE_MAX < pkt_no_type || !div_sz)
     {
       return -EINVAL;
     }
 
-  total_pkt_num =
-    (virtual_file_sz % div_sz) == 0 ?
-    (virtual_file_sz / div_sz) : (virtual_file_sz / div_sz) + 1;
-  printf("total_pkt_num:%d\n", total_pkt_num);
+  gacrux_upload_src_zero(&src, virtual_file_sz);
+
+  g_upload.total_pkt_type = total_pkt_type;
+  g_upload.pkt_no_type    = pkt_no_type;
+
+  /* Packet numbering is what is under test, always send plain data. */
 
-  if (pkt_no_type == PKT_NO_TYPE_OVER_TOTAL_NUM)
+  return upload_run(&g_upload_pktzr_dbgtxfw, &src, div_sz,
+                    COMPCONF_OPR_NONE);
+}
+
+int gacrux_cmd_bin_input(uint8_t input, const char *fw_path)
+{
+  int                        ret;
+  struct gacrux_upload_src_s src;
+  char                       path[PATH_MAX];
+
+  CHECKINIT();
+
+  if (!fw_path)
+  {
+    return -EINVAL;
+  }
+
+  ret = gacrux_cmd_bin_input_path(path, sizeof(path), fw_path);
+  if (ret < 0)
     {
-      loop_num = total_pkt_num + 2; /* Run excess loop two times */
+      return ret;
     }
-  else
+
+  ret = gacrux_upload_src_file(&src, path);
+  if (ret < 0)
     {
-      loop_num = total_pkt_num;
+      return ret;
     }
-  printf("loop_num:%d\n", loop_num);
 
-  cmd = malloc(TXFW_CMD_SIZE(div_sz));
-  if (!cmd)
+  ret = gacrux_cmd_bin_input_src(input, &src);
+
+  gacrux_upload_src_close(&src);
+
+  return ret;
+}
+
+int gacrux_cmd_bin_input_src(uint8_t input,
+                             FAR struct gacrux_upload_src_s *src)
+{
+  CHECKINIT();
+
+  if (!src)
     {
-      printf("Failed to allocate divided FW buf.\n");
-      ret = -errno;
-      goto exit;
+      return -EINVAL;
     }
 
-  host = host_if_fctry_get_obj(g_hif_type);
+  g_upload.input = input;
+
+  return upload_run(&g_upload_pktzr_binin, src, g_bin_input_one_packet_sz,
+                    g_tx_comp);
+}
+
+int gacrux_cmd_bin_input_path(FAR char *path, size_t path_len,
+                              FAR const char *fw_path)
+{
+  int ret;
 
-  for (i=0; i<loop_num; i++)
+  if (!path || !fw_path)
     {
-      memset(cmd, 0, TXFW_CMD_SIZE(div_sz));
+      return -EINVAL;
+    }
 
-      pkt_len = div_sz < (virtual_file_sz - total_tx_len) ?
-                div_sz : (virtual_file_sz - total_tx_len);
+  /* Relative path is looked up in BIN_INPUT_DIR. */
 
-      /* ++ Create command ++ */
-      cmd[GHIFP_SYNC_OFFSET]                  = GHIFP_SYNC;
-      *(uint16_t *)&cmd[GHIFP_OPR_LEN_OFFSET] = TXFW_OPR_SIZE(pkt_len); /* Set OPC len by little endian. */
-      cmd[GHIFP_OPC_OFFSET]                   = TXFW_OPC;
-      cmd[GHIFP_H_CHECKSUM_OFFSET]            = calc_checksum(cmd, 4);
+  ret = snprintf(path, path_len, "%s%s",
+                 fw_path[0] == '/' ? "" : BIN_INPUT_DIR, fw_path);
+  if (ret < 0 || path_len <= ret)
+    {
+      printf("Too long path.\n");
+      return -ENAMETOOLONG;
+    }
 
-      switch (total_pkt_type)
-        {
-          case TOTAL_PKT_NUM_TYPE_NORMAL:
-            *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = total_pkt_num;
-            break;
-          case TOTAL_PKT_NUM_TYPE_ZERO:
-            *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = 0;
-            break;
-          case TOTAL_PKT_NUM_TYPE_INVALID:
-            *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = total_pkt_num + 1;
-            break;
-          case TOTAL_PKT_NUM_TYPE_SHIFT_PLUS:
-            *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] =
-              total_pkt_num <= i * 2 ? total_pkt_num + 1 : total_pkt_num;
-            break;
-          case TOTAL_PKT_NUM_TYPE_SHIFT_MINUS:
-            *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] =
-              total_pkt_num <= i * 2 ? total_pkt_num - 1 : total_pkt_num;
-            break;
-          default:
-            break;
-        }
+  return 0;
+}
 
-      switch (pkt_no_type)
-        {
-          case PKT_NO_TYPE_NORMAL:
-            *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i+1; /* 1, 2, 3, 4, ... */
-            break;
-          case PKT_NO_TYPE_INCREMENT_FROM_ZERO:
-            *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i; /* 0, 1, 2, 3, ... */
-            break;
-          case PKT_NO_TYPE_NO_INCREMENT:
-            *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = 1; /* 1, 1, 1, 1, ... */
-            break;
-          case PKT_NO_TYPE_OVER_INCREMENT:
-            *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] =
-              (i * 2) + 1; /* 1, 3, 5, 7, ... */
-            break;
-          case PKT_NO_TYPE_OVER_TOTAL_NUM:
-            /* Do nothing in here */
-            *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i+1; /* 1, 2, 3, 4, ... */
-            break;
-          default:
-            break;
-        }
+int gacrux_cmd_compconf(uint8_t codec)
+{
+  int                  ret;
+  FAR struct host_if_s *host;
+  uint8_t              cmd[COMPCONF_CMD_SIZE] = {0};
+  uint32_t             res_len;
 
-      total_tx_len += pkt_len;
+  CHECKINIT();
 
-      cmd[GHIFP_D_CHECKSUM_OFFSET(TXFW_OPR_SIZE(pkt_len))] =
-        calc_checksum(&cmd[GHIFP_OPR_OFFSET], TXFW_OPR_SIZE(pkt_len));
-      /* -- Create command -- */
+  printf("codec:0x%02X\n", codec);
 
-      printf("Packet(%d/%d) fw part size:%ld\n", i+1, total_pkt_num, pkt_len);
+  if (COMPCONF_OPR_LZ4BLK < codec)
+    {
+      printf("Unsupported codec.\n");
+      return -EINVAL;
+    }
 
-      ret = host->transaction(host, cmd, TXFW_CMD_SIZE(pkt_len),
-                              g_recv_buff, RECV_BUFF_SZ, &res_len);
-      if (ret != 0)
-        {
-          printf("Transaction error:%d\n", ret);
-          break;
-        }
+  host = host_if_fctry_get_obj(g_hif_type);
 
-      ret = tx_fw_res_check(g_recv_buff, res_len);
-      if (ret != 0)
-        {
-          printf("Transaction error:%d\n", ret);
-          break;
-        }
-      else
-        {
-          printf("Completed transfer of packet No.%d \n", i+1);
-        }
+  ret = compconf_cmd_create(cmd, COMPCONF_CMD_SIZE, codec);
+  if (ret != 0)
+    {
+      printf("Cmd create error:%d\n", ret);
+      goto exit;
     }
 
-    if (ret == 0)
-      {
-        printf("Completed all transfers!!\n");
-      }
+  ret = host->transaction(host, cmd, COMPCONF_CMD_SIZE,
+                          g_recv_buff, RECV_BUFF_SZ, &res_len);
+  if (ret != 0)
+    {
+      printf("Transaction error:%d\n", ret);
+      goto exit;
+    }
 
-exit:
+  /* Only switch when the device accepted the codec. */
 
-  if (cmd)
+  ret = compconf_res_check(g_recv_buff, res_len);
+  if (ret == 0)
     {
-      free(cmd);
+      g_tx_comp = codec;
     }
 
+exit:
+  printf("Compressed transfer:%s\n",
+         g_tx_comp != COMPCONF_OPR_NONE ? "ON" : "OFF");
   return ret;
 }
 
-int gacrux_cmd_bin_input(uint8_t input, const char *fw_path)
+int gacrux_cmd_chunkconf(uint16_t size)
 {
   int                  ret;
-  int                  i;
-  int                  fd;
   FAR struct host_if_s *host;
-  FAR uint8_t          *cmd = NULL;
-  int                  loop_num;
-  uint32_t             pkt_len;
-  uint32_t             total_tx_len = 0;
-  int32_t              file_sz;
+  uint8_t              cmd[CHUNKCONF_CMD_SIZE] = {0};
   uint32_t             res_len;
 
   CHECKINIT();
-  char path[] = "/mnt/spif/";
-  if (!fw_path)
-  {
-    return -EINVAL;
-  }
-  strcat(path, fw_path);
 
-  file_sz = calc_file_sz(path);
-  if (file_sz < 0)
+  if (g_hif_type != HOST_IF_FCTRY_TYPE_I2C &&
+      g_hif_type != HOST_IF_FCTRY_TYPE_SPI)
     {
-      return file_sz;
+      printf("Permitted to execute only when selecting I2C or SPI mode.\n");
+      return -EPERM;
     }
 
-  printf("Division size = %d\n", g_bin_input_one_packet_sz);
+  printf("chunk size:%u\n", size);
 
-  loop_num =
-    (file_sz % g_bin_input_one_packet_sz) == 0 ?
-    (file_sz / g_bin_input_one_packet_sz) : (file_sz / g_bin_input_one_packet_sz) + 1;
-  printf("loop_num:%d\n", loop_num);
-
-  fd = open(path, O_RDONLY);
-  if (fd < 0)
+  if (size < CHUNKCONF_SIZE_MIN || CHUNKCONF_SIZE_MAX < size)
     {
-      printf("Failed to open FW file.\n");
-      return fd;
+      printf("Unsupported chunk size. %d - %d\n",
+             CHUNKCONF_SIZE_MIN, CHUNKCONF_SIZE_MAX);
+      return -EINVAL;
     }
 
-  cmd = malloc(TXFW_CMD_SIZE(g_bin_input_one_packet_sz));
-  if (!cmd)
+  /* SPI reads chunks in whole words of up to 32 bits. */
+
+  if (g_hif_type == HOST_IF_FCTRY_TYPE_SPI && (size % 4) != 0)
     {
-      printf("Failed to allocate divided FW buf.\n");
-      ret = -errno;
-      goto exit;
+      printf("Chunk size has to be a multiple of 4 in SPI mode.\n");
+      return -EINVAL;
     }
 
   host = host_if_fctry_get_obj(g_hif_type);
 
-  for (i=0; i<loop_num; i++)
+  ret = chunkconf_cmd_create(cmd, CHUNKCONF_CMD_SIZE, size);
+  if (ret != 0)
+    {
+      printf("Cmd create error:%d\n", ret);
+      return ret;
+    }
+
+  /* The response is read by the old chunk size. */
+
+  ret = host->transaction(host, cmd, CHUNKCONF_CMD_SIZE,
+                          g_recv_buff, RECV_BUFF_SZ, &res_len);
+  if (ret != 0)
+    {
+      printf("Transaction error:%d\n", ret);
+      return ret;
+    }
+
+  /* Only switch when Gacrux accepted the size, e.g. it fits its FIFO. */
+
+  ret = chunkconf_res_check(g_recv_buff, res_len);
+  if (ret == 0)
     {
-      pkt_len = g_bin_input_one_packet_sz < (file_sz - total_tx_len) ?
-                g_bin_input_one_packet_sz : (file_sz - total_tx_len);
+      ret = host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETCHUNK,
+                             (void *)&size);
+    }
+
+  return ret;
+}
+
+int gacrux_cmd_parallel_tx_fw(uint8_t if_mask, const char *fw_path)
+{
+  int                          ret = 0;
+  int                          i;
+  int                          bus_num = 0;
+  enum host_if_fctry_type_e    bus_type = g_hif_type;
+  struct parallel_target_s     target[HOST_IF_FCTRY_TYPE_NUM];
+  FAR struct parallel_target_s *t;
+  FAR uint8_t                  *recv;
+  pthread_attr_t               attr;
+  uint32_t                     total_len = 0;
+  uint32_t                     ms;
+  struct timespec              start;
+  struct timespec              end;
+
+  CHECKINIT();
 
-      /* ++ Create command ++ */
-      cmd[GHIFP_SYNC_OFFSET]                           = GHIFP_SYNC;
-      *(uint16_t *)&cmd[GHIFP_OPR_LEN_OFFSET]          = pkt_len + 3;
-      cmd[GHIFP_OPC_OFFSET]                            = TX_BIN_OPC;
-      cmd[GHIFP_H_CHECKSUM_OFFSET]                     = calc_checksum(cmd, 4);
+  if (!fw_path || !if_mask || (1 << HOST_IF_FCTRY_TYPE_NUM) <= if_mask)
+    {
+      return -EINVAL;
+    }
 
-      /* Send header */
-      ret = host->write(host, cmd, GHIFP_HEADER_SIZE);
-      up_mdelay(5);
+  /* With a shared bus request pin, only one of I2C and SPI can run and
+   * the request is routed to it. g_hif_type stays as it is for other
+   * commands and events.
+   */
 
-      /* Send data */
-      *(uint8_t *)&cmd[5] = input;
-      *(uint8_t *)&cmd[6] = loop_num;
-      *(uint16_t *)&cmd[7] = i+1;
+  for (i=HOST_IF_FCTRY_TYPE_I2C; i<=HOST_IF_FCTRY_TYPE_SPI; i++)
+    {
+      if (if_mask & (1 << i))
+        {
+          bus_num++;
+          bus_type = (enum host_if_fctry_type_e)i;
+        }
+    }
 
-      ret = read(fd, &cmd[8], pkt_len);
-      printf("pkt_len:%ld\n", pkt_len);
-      if (ret != pkt_len)
+  if (bus_req_is_shared())
+    {
+      if (1 < bus_num)
         {
-          printf("File read error. len:%d expected len:%lu\n", ret, pkt_len);
-          ret = -EIO;
-          break;
+          printf("I2C and SPI share the bus request pin.\n");
+          return -ENOTSUP;
         }
-      total_tx_len += ret;
 
-      cmd[GHIFP_D_CHECKSUM_OFFSET(pkt_len+3)] =
-        calc_checksum(&cmd[GHIFP_OPR_OFFSET], TXFW_OPR_SIZE(pkt_len)-1);
-      /* -- Create command -- */
+      bus_req_set_route(bus_type);
+    }
 
-      printf("Packet(%d/%d) fw part size:%ld\n", i+1, loop_num, pkt_len);
-      ret = host->transaction(host, cmd + GHIFP_HEADER_SIZE, pkt_len + 4,
-                          g_recv_buff, RECV_BUFF_SZ, &res_len);
-      // ret = host->write(host, cmd + GHIFP_HEADER_SIZE,  pkt_len + 4);
+  memset(target, 0, sizeof(target));
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_EXAMPLES_GHIFP_STACKSIZE);
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  for (i=0; i<HOST_IF_FCTRY_TYPE_NUM; i++)
+    {
+      if (!(if_mask & (1 << i)))
+        {
+          continue;
+        }
+
+      t          = &target[i];
+      t->type    = (enum host_if_fctry_type_e)i;
+      t->host    = host_if_fctry_get_obj(t->type);
+      t->fw_path = fw_path;
+
+      recv = malloc(RECV_BUFF_SZ);
+      if (!recv)
+        {
+          printf("Failed to allocate recv buf.\n");
+          t->ret = -ENOMEM;
+          continue;
+        }
+
+      gacrux_upload_init(&t->upload, recv, RECV_BUFF_SZ);
+
+      ret = pthread_create(&t->thread, &attr, parallel_tx_fw_thread, t);
       if (ret != 0)
         {
-          printf("Transaction error:%d\n", ret);
-          break;
+          printf("Failed to start %s thread:%d\n", g_hif_name[i], ret);
+          t->ret = -ret;
+          continue;
         }
 
-      // ret = bin_input_res_check(g_recv_buff, res_len);
-      // if (ret != 0)
-      //   {
-      //     printf("Transaction error:%d\n", ret);
-      //     break;
-      //   }
-        up_mdelay(5);
+      t->running = true;
     }
 
-    if (ret == 0)
-      {
-        printf("Completed all transfers!!\n");
-      }
+  ret = 0;
+  for (i=0; i<HOST_IF_FCTRY_TYPE_NUM; i++)
+    {
+      t = &target[i];
 
-exit:
+      if (t->running)
+        {
+          pthread_join(t->thread, NULL);
+        }
 
-  close(fd);
+      if (t->upload.recv)
+        {
+          free(t->upload.recv);
+          t->upload.recv = NULL;
+        }
+    }
 
-  if (cmd)
+  clock_gettime(CLOCK_REALTIME, &end);
+  ms = (uint32_t)((end.tv_sec - start.tv_sec) * 1000 +
+                  (end.tv_nsec - start.tv_nsec) / 1000000);
+
+  pthread_attr_destroy(&attr);
+  bus_req_set_route(BUS_REQ_ROUTE_HIF);
+
+  /* Report */
+
+  for (i=0; i<HOST_IF_FCTRY_TYPE_NUM; i++)
     {
-      free(cmd);
+      t = &target[i];
+
+      if (!(if_mask & (1 << i)))
+        {
+          continue;
+        }
+
+      printf("%-4s ret:%d %lu bytes, %lu ms, %lu B/s\n",
+             g_hif_name[i], t->ret, t->upload.stat.bytes,
+             t->upload.stat.elapsed_ms, t->upload.stat.avg_bps);
+
+      total_len += t->upload.stat.bytes;
+
+      if (t->ret != 0 && ret == 0)
+        {
+          ret = t->ret;
+        }
+
+      gacrux_upload_fin(&t->upload);
     }
 
+  printf("All  %lu bytes, %lu ms, %lu B/s\n",
+         total_len, ms, ms ? total_len * 1000 / ms : 0);
+
   return ret;
 }
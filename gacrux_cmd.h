@@ -6,6 +6,7 @@
  ****************************************************************************/
 
 #include <stdint.h>
+#include <stddef.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -15,6 +16,8 @@
  * Public Types
  ****************************************************************************/
 
+struct gacrux_upload_src_s;
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -23,22 +26,35 @@ int gacrux_cmd_init(void);
 int gacrux_cmd_deinit(void);
 int gacrux_cmd_change_sys_status(int stat);
 int gacrux_cmd_tx_fw(const char *fw_path);
+int gacrux_cmd_tx_fw_src(FAR struct gacrux_upload_src_s *src);
 int gacrux_cmd_execute_fw(void);
 int gacrux_cmd_uartconf(uint8_t baudrate, uint8_t flow_ctrl);
+int gacrux_cmd_uartconf_auto(uint8_t flow_ctrl);
+int gacrux_cmd_uart_resync(void);
 int gacrux_cmd_i2cconf(uint8_t speed);
+int gacrux_cmd_chunkconf(uint16_t size);
 int gacrux_cmd_i2cwrite(uint8_t bin_cmd, uint8_t *opr, uint16_t opr_len);
 int gacrux_cmd_i2cread(void);
 int gacrux_cmd_spiconf(uint8_t dfs);
+int gacrux_cmd_spiclk_train(void);
 int gacrux_cmd_spiwrite(uint8_t bin_cmd, uint8_t *opr, uint16_t opr_len);
 int gacrux_cmd_spiread(void);
 int gacrux_cmd_debug_send(char *bin_str, int bin_len);
 int gacrux_cmd_debug_file_send(const char *path);
 int gacrux_cmd_set_if_type(int if_type);
 int gacrux_cmd_get_if_type(void);
+int gacrux_cmd_set_verbose(int level);
+int gacrux_cmd_get_verbose(void);
 int gacrux_cmd_set_division_size(uint16_t sz);
 int gacrux_cmd_set_config(uint32_t req, FAR void *arg);
 int gacrux_cmd_debug_tx_fw(uint32_t virtual_file_sz, uint16_t div_sz,
                            uint8_t total_pkt_type, uint8_t pkt_no_type);
 int gacrux_cmd_bin_input(uint8_t input, const char *fw_path);
+int gacrux_cmd_bin_input_src(uint8_t input,
+                             FAR struct gacrux_upload_src_s *src);
+int gacrux_cmd_bin_input_path(FAR char *path, size_t path_len,
+                              FAR const char *fw_path);
+int gacrux_cmd_compconf(uint8_t codec);
+int gacrux_cmd_parallel_tx_fw(uint8_t if_mask, const char *fw_path);
 
 #endif /* __APPS_EXAMPLES_GHIFP_GACRUX_CMD_H */
@@ -0,0 +1,298 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gacrux_lz.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* LZ4 block format constraints */
+
+#define MINMATCH     (4)
+#define LASTLITERALS (5)  /* The last 5 bytes are always literals */
+#define MFLIMIT      (12) /* The last match must start 12 bytes before end */
+#define MAX_OFFSET   (0xffff)
+#define RUN_MASK     (15)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline uint32_t read32(FAR const uint8_t *p)
+{
+  uint32_t val;
+
+  memcpy(&val, p, sizeof(val));
+
+  return val;
+}
+
+static inline uint32_t lz_hash(uint32_t seq)
+{
+  return (seq * 2654435761u) >> (32 - GACRUX_LZ_HASH_BITS);
+}
+
+static int put_length(FAR uint8_t **op, FAR uint8_t *oend, uint32_t len)
+{
+  while (255 <= len)
+    {
+      if (oend <= *op)
+        {
+          return -ENOSPC;
+        }
+
+      *(*op)++ = 255;
+      len -= 255;
+    }
+
+  if (oend <= *op)
+    {
+      return -ENOSPC;
+    }
+
+  *(*op)++ = (uint8_t)len;
+
+  return 0;
+}
+
+/* Emit one sequence. match_len == 0 means the final literal-only one. */
+
+static int put_sequence(FAR uint8_t **op, FAR uint8_t *oend,
+                        FAR const uint8_t *lit, uint32_t lit_len,
+                        uint32_t offset, uint32_t match_len)
+{
+  FAR uint8_t *token;
+
+  if (oend <= *op)
+    {
+      return -ENOSPC;
+    }
+
+  token  = (*op)++;
+  *token = (uint8_t)((lit_len < RUN_MASK ? lit_len : RUN_MASK) << 4);
+
+  if (RUN_MASK <= lit_len &&
+      put_length(op, oend, lit_len - RUN_MASK) < 0)
+    {
+      return -ENOSPC;
+    }
+
+  if ((uint32_t)(oend - *op) < lit_len)
+    {
+      return -ENOSPC;
+    }
+
+  memcpy(*op, lit, lit_len);
+  *op += lit_len;
+
+  if (match_len == 0)
+    {
+      return 0;
+    }
+
+  if (oend - *op < 2)
+    {
+      return -ENOSPC;
+    }
+
+  (*op)[0] = (uint8_t)(offset & 0xff); /* Little endian */
+  (*op)[1] = (uint8_t)(offset >> 8);
+  *op += 2;
+
+  match_len -= MINMATCH;
+  *token |= (uint8_t)(match_len < RUN_MASK ? match_len : RUN_MASK);
+
+  if (RUN_MASK <= match_len &&
+      put_length(op, oend, match_len - RUN_MASK) < 0)
+    {
+      return -ENOSPC;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int gacrux_lz_compress(FAR const uint8_t *src, uint32_t src_len,
+                       FAR uint8_t *dst, uint32_t dst_cap,
+                       FAR void *work)
+{
+  FAR uint16_t      *table = (FAR uint16_t *)work;
+  FAR const uint8_t *ip = src;
+  FAR const uint8_t *anchor = src;
+  FAR const uint8_t *iend = src + src_len;
+  FAR const uint8_t *ref;
+  FAR uint8_t       *op = dst;
+  FAR uint8_t       *oend = dst + dst_cap;
+  uint32_t          h;
+  uint32_t          len;
+
+  if (!src || !dst || !work || GACRUX_LZ_SRC_MAX < src_len)
+    {
+      return -EINVAL;
+    }
+
+  memset(table, 0, GACRUX_LZ_WORK_SZ);
+
+  if (MFLIMIT < src_len)
+    {
+      while (ip < iend - MFLIMIT)
+        {
+          h        = lz_hash(read32(ip));
+          ref      = src + table[h];
+          table[h] = (uint16_t)(ip - src);
+
+          if (ip <= ref || MAX_OFFSET < ip - ref ||
+              read32(ref) != read32(ip))
+            {
+              ip++;
+              continue;
+            }
+
+          /* Extend the match backwards over pending literals. */
+
+          while (anchor < ip && src < ref && ip[-1] == ref[-1])
+            {
+              ip--;
+              ref--;
+            }
+
+          /* Extend forwards, keeping LASTLITERALS at the tail. */
+
+          len = MINMATCH;
+          while (ip + len < iend - LASTLITERALS && ip[len] == ref[len])
+            {
+              len++;
+            }
+
+          if (put_sequence(&op, oend, anchor, (uint32_t)(ip - anchor),
+                           (uint32_t)(ip - ref), len) < 0)
+            {
+              return -ENOSPC;
+            }
+
+          ip     += len;
+          anchor  = ip;
+        }
+    }
+
+  if (put_sequence(&op, oend, anchor, (uint32_t)(iend - anchor), 0, 0) < 0)
+    {
+      return -ENOSPC;
+    }
+
+  return (int)(op - dst);
+}
+
+int gacrux_lz_decompress(FAR const uint8_t *src, uint32_t src_len,
+                         FAR uint8_t *dst, uint32_t dst_cap)
+{
+  FAR const uint8_t *ip = src;
+  FAR const uint8_t *iend = src + src_len;
+  FAR const uint8_t *ref;
+  FAR uint8_t       *op = dst;
+  FAR uint8_t       *oend = dst + dst_cap;
+  uint8_t           token;
+  uint8_t           s;
+  uint32_t          len;
+  uint32_t          offset;
+
+  if (!src || !dst || !src_len)
+    {
+      return -EINVAL;
+    }
+
+  while (ip < iend)
+    {
+      token = *ip++;
+
+      /* Literals */
+
+      len = token >> 4;
+      if (len == RUN_MASK)
+        {
+          do
+            {
+              if (iend <= ip)
+                {
+                  return -EINVAL;
+                }
+
+              s    = *ip++;
+              len += s;
+            }
+          while (s == 255);
+        }
+
+      if ((uint32_t)(iend - ip) < len || (uint32_t)(oend - op) < len)
+        {
+          return -EINVAL;
+        }
+
+      memcpy(op, ip, len);
+      op += len;
+      ip += len;
+
+      if (iend <= ip)
+        {
+          break; /* Last sequence has no match part. */
+        }
+
+      /* Match */
+
+      if (iend - ip < 2)
+        {
+          return -EINVAL;
+        }
+
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+
+      if (offset == 0 || (uint32_t)(op - dst) < offset)
+        {
+          return -EINVAL;
+        }
+
+      len = token & RUN_MASK;
+      if (len == RUN_MASK)
+        {
+          do
+            {
+              if (iend <= ip)
+                {
+                  return -EINVAL;
+                }
+
+              s    = *ip++;
+              len += s;
+            }
+          while (s == 255);
+        }
+
+      len += MINMATCH;
+      if ((uint32_t)(oend - op) < len)
+        {
+          return -EINVAL;
+        }
+
+      /* Byte copy, the source may overlap the destination. */
+
+      ref = op - offset;
+      while (len--)
+        {
+          *op++ = *ref++;
+        }
+    }
+
+  return (int)(op - dst);
+}
@@ -0,0 +1,42 @@
+#ifndef __APPS_EXAMPLES_GHIFP_GACRUX_LZ_H
+#define __APPS_EXAMPLES_GHIFP_GACRUX_LZ_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* LZ4 block format codec for compressed TXFW / BININ payloads.
+ * Every packet is compressed independently, so the receiver never needs
+ * more window than one division size (<= GHIFP_OPR_LEN_MAX).
+ */
+
+#define GACRUX_LZ_HASH_BITS (10)
+#define GACRUX_LZ_WORK_SZ   ((1 << GACRUX_LZ_HASH_BITS) * sizeof(uint16_t))
+#define GACRUX_LZ_SRC_MAX   (0xffff) /* Positions are kept in uint16_t */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Return compressed length, or -ENOSPC if the result does not fit in
+ * dst_cap (the caller then sends the packet stored).
+ */
+
+int gacrux_lz_compress(FAR const uint8_t *src, uint32_t src_len,
+                       FAR uint8_t *dst, uint32_t dst_cap,
+                       FAR void *work);
+
+/* Reference decoder, the same logic the device side runs.
+ * Return decompressed length, or -EINVAL on a malformed block.
+ */
+
+int gacrux_lz_decompress(FAR const uint8_t *src, uint32_t src_len,
+                         FAR uint8_t *dst, uint32_t dst_cap);
+
+#endif /* __APPS_EXAMPLES_GHIFP_GACRUX_LZ_H */
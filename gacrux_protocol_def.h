@@ -55,11 +55,31 @@
 #define TXFW_OPR_TOTAL_PKT_NUM_OFFSET (5)
 #define TXFW_OPR_PKT_NUM_OFFSET       (7)
 #define TXFW_OPR_PKT_OFFSET           (9)
+#define TXFW_PREAMBLE_SIZE            (TXFW_OPR_PKT_OFFSET - GHIFP_OPR_OFFSET)
+#define TXFW_PKT_NUM_MAX              (0xffff)
+
+/* Binary input(OPC 7) uses a one byte packet count. */
+
+#define TXBIN_OPR_INPUT_OFFSET         (5)
+#define TXBIN_OPR_TOTAL_PKT_NUM_OFFSET (6)
+#define TXBIN_OPR_PKT_NUM_OFFSET       (7)
+#define TXBIN_OPR_PKT_OFFSET           (8)
+#define TXBIN_PREAMBLE_SIZE            (TXBIN_OPR_PKT_OFFSET - GHIFP_OPR_OFFSET)
+#define TXBIN_PKT_NUM_MAX              (0xff)
 
 #define TXFW_RES_OPR_SIZE             (1)
 #define TXFW_RES_SIZE                 (GHIFP_HEADER_SIZE + \
                                        GHIFP_DATA_SIZE(TXFW_RES_OPR_SIZE))
 
+/* Compressed packet area, used while COMPCONF is enabled.
+ * | uncompressed len(2) | LZ4 block or stored data |
+ * The stored flag is set when the packet does not compress.
+ */
+
+#define TXFW_COMP_HDR_SIZE            (2)
+#define TXFW_COMP_STORED              (0x8000)
+#define TXFW_COMP_LEN_MASK            (0x7fff)
+
 /* Execute FW */
 
 #define EXECFW_OPC          (0x2)
@@ -132,6 +152,34 @@
 #define SPICONF_RES_SIZE     (GHIFP_HEADER_SIZE + \
                               GHIFP_DATA_SIZE(SPICONF_RES_OPR_SIZE))
 
+/* Change compressed transfer config */
+
+#define COMPCONF_OPC            (0xc)
+#define COMPCONF_OPR_SIZE       (1)
+#define COMPCONF_CMD_SIZE       (GHIFP_HEADER_SIZE + \
+                                 GHIFP_DATA_SIZE(COMPCONF_OPR_SIZE))
+#define COMPCONF_OPR_NONE       (0x0)
+#define COMPCONF_OPR_LZ4BLK     (0x1)
+
+#define COMPCONF_RES_OPR_SIZE   (1)
+#define COMPCONF_RES_SIZE       (GHIFP_HEADER_SIZE + \
+                                 GHIFP_DATA_SIZE(COMPCONF_RES_OPR_SIZE))
+
+/* Change receive chunk size of I2C and SPI.
+ * Gacrux requests the bus once per chunk of a frame it sends.
+ */
+
+#define CHUNKCONF_OPC           (0xd)
+#define CHUNKCONF_OPR_SIZE      (2) /* Chunk size by little endian */
+#define CHUNKCONF_CMD_SIZE      (GHIFP_HEADER_SIZE + \
+                                 GHIFP_DATA_SIZE(CHUNKCONF_OPR_SIZE))
+#define CHUNKCONF_SIZE_MIN      (256)
+#define CHUNKCONF_SIZE_MAX      (4096)
+
+#define CHUNKCONF_RES_OPR_SIZE  (1)
+#define CHUNKCONF_RES_SIZE      (GHIFP_HEADER_SIZE + \
+                                 GHIFP_DATA_SIZE(CHUNKCONF_RES_OPR_SIZE))
+
 /* Frame check error */
 
 #define FRAMECHKERR_OPC         (0xFF)
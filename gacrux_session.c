@@ -0,0 +1,476 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "gacrux_session.h"
+#include "gacrux_cmd.h"
+#include "gacrux_upload.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SESSION_LINE_MAX (PATH_MAX + 32)
+#define SESSION_DELIM    " \t\r\n"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum session_step_type_e
+{
+  SESSION_STEP_INIT = 0,
+  SESSION_STEP_CHGIF,
+  SESSION_STEP_COMPCONF,
+  SESSION_STEP_TXFW,
+  SESSION_STEP_EXECFW,
+  SESSION_STEP_BININ,
+  SESSION_STEP_NUM,
+};
+
+struct session_step_s
+{
+  enum session_step_type_e type;
+  int                      arg;
+  char                     path[PATH_MAX];
+};
+
+/* Next image read in background while the current one is sent. */
+
+struct session_prefetch_s
+{
+  pthread_t      thread;
+  bool           running;
+  FAR const char *path;
+  FAR uint8_t    *buf;
+  uint32_t       size;
+  int            ret;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Keyword and the number of arguments of each step. */
+
+static const struct
+{
+  FAR const char *key;
+  int            argc;
+} g_step_def[SESSION_STEP_NUM] =
+{
+  [SESSION_STEP_INIT]     = { "INIT",     0 },
+  [SESSION_STEP_CHGIF]    = { "CHGIF",    1 },
+  [SESSION_STEP_COMPCONF] = { "COMPCONF", 1 },
+  [SESSION_STEP_TXFW]     = { "TXFW",     1 },
+  [SESSION_STEP_EXECFW]   = { "EXECFW",   0 },
+  [SESSION_STEP_BININ]    = { "BININ",    2 },
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static bool is_image_step(FAR const struct session_step_s *step)
+{
+  return step->type == SESSION_STEP_TXFW || step->type == SESSION_STEP_BININ;
+}
+
+static int step_parse(FAR char *line, FAR struct session_step_s *step)
+{
+  int       ret;
+  int       type;
+  int       argc = 0;
+  FAR char  *argv[3];
+  FAR char  *save;
+  FAR char  *tok;
+
+  tok = strtok_r(line, SESSION_DELIM, &save);
+  while (tok && argc < 3)
+    {
+      argv[argc++] = tok;
+      tok = strtok_r(NULL, SESSION_DELIM, &save);
+    }
+
+  for (type=0; type<SESSION_STEP_NUM; type++)
+    {
+      if (0 == strcasecmp(argv[0], g_step_def[type].key))
+        {
+          break;
+        }
+    }
+
+  if (type == SESSION_STEP_NUM)
+    {
+      printf("Unknown step:%s\n", argv[0]);
+      return -EINVAL;
+    }
+
+  if (tok || argc - 1 != g_step_def[type].argc)
+    {
+      printf("The number of arguments is incorrect. %s\n", argv[0]);
+      return -EINVAL;
+    }
+
+  step->type = (enum session_step_type_e)type;
+  step->arg  = 0;
+
+  switch (step->type)
+    {
+      case SESSION_STEP_CHGIF:
+      case SESSION_STEP_COMPCONF:
+        step->arg = atoi(argv[1]);
+        break;
+      case SESSION_STEP_TXFW:
+        ret = snprintf(step->path, sizeof(step->path), "%s", argv[1]);
+        if (ret < 0 || sizeof(step->path) <= ret)
+          {
+            printf("Too long path.\n");
+            return -ENAMETOOLONG;
+          }
+        break;
+      case SESSION_STEP_BININ:
+        step->arg = atoi(argv[1]);
+        ret = gacrux_cmd_bin_input_path(step->path, sizeof(step->path),
+                                        argv[2]);
+        if (ret < 0)
+          {
+            return ret;
+          }
+        break;
+      default:
+        break;
+    }
+
+  return 0;
+}
+
+static int manifest_parse(FAR const char *manifest_path,
+                          FAR struct session_step_s *steps, int step_max)
+{
+  int      ret = 0;
+  int      num = 0;
+  int      line_no = 0;
+  FAR FILE *fp;
+  FAR char *p;
+  char     line[SESSION_LINE_MAX];
+
+  fp = fopen(manifest_path, "r");
+  if (!fp)
+    {
+      printf("Failed to open manifest.\n");
+      return -errno;
+    }
+
+  while (fgets(line, sizeof(line), fp))
+    {
+      line_no++;
+
+      p = strchr(line, '#');
+      if (p)
+        {
+          *p = '\0'; /* Cut comment */
+        }
+
+      p = line + strspn(line, SESSION_DELIM);
+      if (*p == '\0')
+        {
+          continue; /* Empty line */
+        }
+
+      if (num == step_max)
+        {
+          printf("Too many steps. max:%d\n", step_max);
+          ret = -E2BIG;
+          goto exit;
+        }
+
+      ret = step_parse(p, &steps[num]);
+      if (ret < 0)
+        {
+          printf("Manifest error at line %d\n", line_no);
+          goto exit;
+        }
+
+      num++;
+    }
+
+  ret = num;
+
+exit:
+  fclose(fp);
+  return ret;
+}
+
+static FAR void *prefetch_thread(FAR void *arg)
+{
+  FAR struct session_prefetch_s *pf = (FAR struct session_prefetch_s *)arg;
+  int                           fd;
+  off_t                         file_sz;
+  uint32_t                      len = 0;
+  int                           ret;
+
+  fd = open(pf->path, O_RDONLY);
+  if (fd < 0)
+    {
+      pf->ret = -errno;
+      return NULL;
+    }
+
+  file_sz = lseek(fd, 0, SEEK_END);
+  if (file_sz < 0 || SESSION_PREFETCH_MAX < file_sz ||
+      lseek(fd, 0, SEEK_SET) < 0)
+    {
+      pf->ret = -EFBIG; /* Send from file instead. */
+      goto exit;
+    }
+
+  pf->buf = malloc(file_sz ? file_sz : 1);
+  if (!pf->buf)
+    {
+      pf->ret = -ENOMEM;
+      goto exit;
+    }
+
+  while (len < file_sz)
+    {
+      ret = read(fd, &pf->buf[len], file_sz - len);
+      if (ret <= 0)
+        {
+          free(pf->buf);
+          pf->buf = NULL;
+          pf->ret = -EIO;
+          goto exit;
+        }
+
+      len += ret;
+    }
+
+  pf->size = len;
+  pf->ret  = 0;
+
+exit:
+  close(fd);
+  return NULL;
+}
+
+static void prefetch_start(FAR struct session_prefetch_s *pf,
+                           FAR const char *path)
+{
+  int ret;
+
+  memset(pf, 0, sizeof(struct session_prefetch_s));
+  pf->path = path;
+  pf->ret  = -EAGAIN;
+
+  ret = pthread_create(&pf->thread, NULL, prefetch_thread, pf);
+  if (ret != 0)
+    {
+      pf->ret = -ret; /* Send from file instead. */
+      return;
+    }
+
+  pf->running = true;
+}
+
+static void prefetch_wait(FAR struct session_prefetch_s *pf)
+{
+  if (pf->running)
+    {
+      pthread_join(pf->thread, NULL);
+      pf->running = false;
+    }
+}
+
+static void prefetch_release(FAR struct session_prefetch_s *pf)
+{
+  prefetch_wait(pf);
+
+  if (pf->buf)
+    {
+      free(pf->buf);
+      pf->buf = NULL;
+    }
+}
+
+static int next_image(FAR struct session_step_s *steps, int num, int from)
+{
+  int i;
+
+  for (i=from; i<num; i++)
+    {
+      if (is_image_step(&steps[i]))
+        {
+          return i;
+        }
+    }
+
+  return -1;
+}
+
+/* Send the image of steps[i]. It was prefetched to pf[*cur], and the next
+ * image is prefetched to the other one while this one is sent.
+ */
+
+static int session_upload(FAR struct session_step_s *steps, int num, int i,
+                          FAR struct session_prefetch_s *pf, FAR int *cur)
+{
+  int                           ret;
+  int                           next;
+  FAR struct session_step_s     *step = &steps[i];
+  FAR struct session_prefetch_s *now = &pf[*cur];
+  struct gacrux_upload_src_s    src;
+
+  prefetch_wait(now);
+
+  next = next_image(steps, num, i + 1);
+  if (0 <= next)
+    {
+      prefetch_start(&pf[*cur ^ 1], steps[next].path);
+    }
+
+  if (now->ret == 0)
+    {
+      printf("Prefetched %s (%lu bytes)\n", step->path, now->size);
+      gacrux_upload_src_mem(&src, now->buf, now->size);
+    }
+  else
+    {
+      ret = gacrux_upload_src_file(&src, step->path);
+      if (ret < 0)
+        {
+          goto exit;
+        }
+    }
+
+  if (step->type == SESSION_STEP_TXFW)
+    {
+      ret = gacrux_cmd_tx_fw_src(&src);
+    }
+  else
+    {
+      ret = gacrux_cmd_bin_input_src((uint8_t)step->arg, &src);
+    }
+
+  gacrux_upload_src_close(&src);
+
+exit:
+  prefetch_release(now);
+  *cur ^= 1;
+
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int gacrux_session_run(FAR const char *manifest_path)
+{
+  int                           ret;
+  int                           i;
+  int                           num;
+  int                           cur = 0;
+  FAR struct session_step_s     *steps;
+  struct session_prefetch_s     pf[2];
+  struct timespec               start;
+  struct timespec               end;
+
+  if (!manifest_path)
+    {
+      return -EINVAL;
+    }
+
+  steps = malloc(sizeof(struct session_step_s) * SESSION_STEP_MAX);
+  if (!steps)
+    {
+      printf("Failed to allocate manifest buf.\n");
+      return -ENOMEM;
+    }
+
+  /* Check the whole manifest before touching Gacrux. */
+
+  num = manifest_parse(manifest_path, steps, SESSION_STEP_MAX);
+  if (num < 0)
+    {
+      ret = num;
+      goto exit;
+    }
+
+  memset(pf, 0, sizeof(pf));
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  i = next_image(steps, num, 0);
+  if (0 <= i)
+    {
+      prefetch_start(&pf[cur], steps[i].path);
+    }
+
+  ret = 0;
+  for (i=0; i<num; i++)
+    {
+      printf("Step(%d/%d) %s\n", i+1, num, g_step_def[steps[i].type].key);
+
+      switch (steps[i].type)
+        {
+          case SESSION_STEP_INIT:
+            ret = gacrux_cmd_init();
+            break;
+          case SESSION_STEP_CHGIF:
+            ret = gacrux_cmd_set_if_type(steps[i].arg);
+            break;
+          case SESSION_STEP_COMPCONF:
+            ret = gacrux_cmd_compconf((uint8_t)steps[i].arg);
+            break;
+          case SESSION_STEP_EXECFW:
+            ret = gacrux_cmd_execute_fw();
+            break;
+          case SESSION_STEP_TXFW:
+          case SESSION_STEP_BININ:
+            ret = session_upload(steps, num, i, pf, &cur);
+            break;
+          default:
+            ret = -EINVAL;
+            break;
+        }
+
+      if (ret != 0)
+        {
+          printf("Step(%d/%d) %s error:%d\n",
+                 i+1, num, g_step_def[steps[i].type].key, ret);
+          break;
+        }
+    }
+
+  prefetch_release(&pf[0]);
+  prefetch_release(&pf[1]);
+
+  clock_gettime(CLOCK_REALTIME, &end);
+
+  if (ret == 0)
+    {
+      printf("Completed all steps!! %d steps, %lu ms\n", num,
+             (uint32_t)((end.tv_sec - start.tv_sec) * 1000 +
+                        (end.tv_nsec - start.tv_nsec) / 1000000));
+    }
+
+exit:
+  free(steps);
+  return ret;
+}
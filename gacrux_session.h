@@ -0,0 +1,34 @@
+#ifndef __APPS_EXAMPLES_GHIFP_GACRUX_SESSION_H
+#define __APPS_EXAMPLES_GHIFP_GACRUX_SESSION_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SESSION_STEP_MAX      (16)
+#define SESSION_PREFETCH_MAX  (128 * 1024) /* Larger image is read from file */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Run every step of a provisioning manifest in order.
+ * One step per line, '#' starts a comment.
+ *
+ *   init
+ *   chgif    [interface num]
+ *   compconf [codec No]
+ *   txfw     [fw_path]
+ *   execfw
+ *   binin    [input] [path]
+ */
+
+int gacrux_session_run(FAR const char *manifest_path);
+
+#endif /* __APPS_EXAMPLES_GHIFP_GACRUX_SESSION_H */
@@ -0,0 +1,907 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "gacrux_upload.h"
+#include "gacrux_lz.h"
+#include "gacrux_protocol_def.h"
+#include "host_if_bs.h"
+#include "host_if_dma.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Decode every compressed packet again with the reference decoder
+ * before sending it.
+ */
+
+#ifdef CONFIG_EXAMPLES_GHIFP_LZ_VERIFY
+#  define GACRUX_LZ_VERIFY
+#endif
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int txfw_res_check(uint8_t *res, uint32_t res_len);
+static void txfw_preamble(FAR struct gacrux_upload_s *up, int i,
+                          FAR uint8_t *cmd);
+static int dbgtxfw_loop_num(FAR struct gacrux_upload_s *up,
+                            int total_pkt_num);
+static void dbgtxfw_preamble(FAR struct gacrux_upload_s *up, int i,
+                             FAR uint8_t *cmd);
+static void binin_preamble(FAR struct gacrux_upload_s *up, int i,
+                           FAR uint8_t *cmd);
+static int comp_packet_create(uint8_t *pkt, uint32_t pkt_cap,
+                              FAR const uint8_t *raw, uint32_t raw_len,
+                              FAR void *work);
+static uint32_t elapsed_ms(FAR const struct timespec *start);
+static uint32_t elapsed_us(FAR const struct timespec *start);
+static void upload_stat_update(FAR struct gacrux_upload_s *up,
+                               uint32_t pkt_len, uint32_t rtt_us);
+static void upload_stat_report(FAR struct gacrux_upload_s *up,
+                               FAR uint32_t *last_ms);
+static int upload_buf_prepare(FAR struct gacrux_upload_s *up);
+static int upload_build(FAR struct gacrux_upload_s *up, int i,
+                        FAR uint8_t *cmd, uint32_t pos,
+                        FAR uint32_t *pkt_len, FAR uint32_t *opr_len);
+static int upload_send(FAR struct gacrux_upload_s *up, FAR uint8_t *cmd,
+                       uint32_t opr_len, FAR uint32_t *res_len);
+static void upload_set_class(FAR struct host_if_s *host, uint8_t tc);
+static int src_file_read(FAR struct gacrux_upload_src_s *src,
+                         FAR uint8_t *buf, uint32_t len);
+static int src_zero_read(FAR struct gacrux_upload_src_s *src,
+                         FAR uint8_t *buf, uint32_t len);
+static int src_mem_read(FAR struct gacrux_upload_src_s *src,
+                        FAR uint8_t *buf, uint32_t len);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* Normal FW transfer */
+
+const struct gacrux_upload_pktzr_s g_upload_pktzr_txfw =
+{
+  .name         = "TXFW",
+  .opc          = TX_BIN_OPC,
+  .preamble_sz  = TXFW_PREAMBLE_SIZE,
+  .max_pkt_num  = TXFW_PKT_NUM_MAX,
+  .split_header = false,
+  .loop_num     = NULL,
+  .preamble     = txfw_preamble,
+  .res_check    = txfw_res_check,
+};
+
+/* FW transfer with broken packet numbering, data is virtual. */
+
+const struct gacrux_upload_pktzr_s g_upload_pktzr_dbgtxfw =
+{
+  .name         = "DBGTXFW",
+  .opc          = TXFW_OPC,
+  .preamble_sz  = TXFW_PREAMBLE_SIZE,
+  .max_pkt_num  = TXFW_PKT_NUM_MAX,
+  .split_header = false,
+  .loop_num     = dbgtxfw_loop_num,
+  .preamble     = dbgtxfw_preamble,
+  .res_check    = txfw_res_check,
+};
+
+/* Binary input(OPC 7) */
+
+const struct gacrux_upload_pktzr_s g_upload_pktzr_binin =
+{
+  .name         = "BININ",
+  .opc          = TX_BIN_OPC,
+  .preamble_sz  = TXBIN_PREAMBLE_SIZE,
+  .max_pkt_num  = TXBIN_PKT_NUM_MAX,
+  .split_header = true,
+  .loop_num     = NULL,
+  .preamble     = binin_preamble,
+  .res_check    = NULL,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int txfw_res_check(uint8_t *res, uint32_t res_len)
+{
+  int ret = 0;
+
+  if (res_len == TXFW_RES_SIZE)
+    {
+      if (res[GHIFP_OPC_OFFSET] != TXFW_OPC)
+        {
+          /* OPC check */
+          printf("Unexpected OPC:0x%02X\n", res[GHIFP_OPC_OFFSET]);
+          ret = -EIO;
+          goto errout;
+        }
+
+      if (res[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
+        {
+          /* Error code check */
+          printf("OPR error:%d\n", (int8_t)res[GHIFP_OPR_OFFSET]);
+          ret = (int8_t)-res[GHIFP_OPR_OFFSET];
+          goto errout;
+        }
+
+      HIF_DBG("Transmit FW result:%d\n", res[GHIFP_OPR_OFFSET]);
+    }
+  else
+    {
+      printf("Unexpected res_len:%ld\n", res_len);
+      ret = -EIO;
+      goto errout;
+    }
+
+errout:
+  return ret;
+}
+
+static void txfw_preamble(FAR struct gacrux_upload_s *up, int i,
+                          FAR uint8_t *cmd)
+{
+  *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = up->total_pkt_num;
+  *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET]       = i+1;
+}
+
+static int dbgtxfw_loop_num(FAR struct gacrux_upload_s *up,
+                            int total_pkt_num)
+{
+  if (up->pkt_no_type == PKT_NO_TYPE_OVER_TOTAL_NUM)
+    {
+      return total_pkt_num + 2; /* Run excess loop two times */
+    }
+
+  return total_pkt_num;
+}
+
+static void dbgtxfw_preamble(FAR struct gacrux_upload_s *up, int i,
+                             FAR uint8_t *cmd)
+{
+  uint16_t total_pkt_num = up->total_pkt_num;
+
+  switch (up->total_pkt_type)
+    {
+      case TOTAL_PKT_NUM_TYPE_NORMAL:
+        *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = total_pkt_num;
+        break;
+      case TOTAL_PKT_NUM_TYPE_ZERO:
+        *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = 0;
+        break;
+      case TOTAL_PKT_NUM_TYPE_INVALID:
+        *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] = total_pkt_num + 1;
+        break;
+      case TOTAL_PKT_NUM_TYPE_SHIFT_PLUS:
+        *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] =
+          total_pkt_num <= i * 2 ? total_pkt_num + 1 : total_pkt_num;
+        break;
+      case TOTAL_PKT_NUM_TYPE_SHIFT_MINUS:
+        *(uint16_t *)&cmd[TXFW_OPR_TOTAL_PKT_NUM_OFFSET] =
+          total_pkt_num <= i * 2 ? total_pkt_num - 1 : total_pkt_num;
+        break;
+      default:
+        break;
+    }
+
+  switch (up->pkt_no_type)
+    {
+      case PKT_NO_TYPE_NORMAL:
+        *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i+1; /* 1, 2, 3, 4, ... */
+        break;
+      case PKT_NO_TYPE_INCREMENT_FROM_ZERO:
+        *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i; /* 0, 1, 2, 3, ... */
+        break;
+      case PKT_NO_TYPE_NO_INCREMENT:
+        *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = 1; /* 1, 1, 1, 1, ... */
+        break;
+      case PKT_NO_TYPE_OVER_INCREMENT:
+        *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] =
+          (i * 2) + 1; /* 1, 3, 5, 7, ... */
+        break;
+      case PKT_NO_TYPE_OVER_TOTAL_NUM:
+        /* Do nothing in here */
+        *(uint16_t *)&cmd[TXFW_OPR_PKT_NUM_OFFSET] = i+1; /* 1, 2, 3, 4, ... */
+        break;
+      default:
+        break;
+    }
+}
+
+static void binin_preamble(FAR struct gacrux_upload_s *up, int i,
+                           FAR uint8_t *cmd)
+{
+  cmd[TXBIN_OPR_INPUT_OFFSET]         = up->input;
+  cmd[TXBIN_OPR_TOTAL_PKT_NUM_OFFSET] = (uint8_t)up->total_pkt_num;
+  cmd[TXBIN_OPR_PKT_NUM_OFFSET]       = (uint8_t)(i+1);
+}
+
+/* Build the packet area of a compressed packet.
+ * Return the packet area length including TXFW_COMP_HDR_SIZE.
+ */
+
+static int comp_packet_create(uint8_t *pkt, uint32_t pkt_cap,
+                              FAR const uint8_t *raw, uint32_t raw_len,
+                              FAR void *work)
+{
+  int      ret = -ENOSPC;
+  uint16_t hdr;
+
+  if (pkt_cap < TXFW_COMP_HDR_SIZE + raw_len ||
+      TXFW_COMP_LEN_MASK < raw_len)
+    {
+      return -EINVAL;
+    }
+
+  /* Must be smaller than raw, or it is not worth sending compressed. */
+
+  if (1 < raw_len)
+    {
+      ret = gacrux_lz_compress(raw, raw_len, &pkt[TXFW_COMP_HDR_SIZE],
+                               raw_len - 1, work);
+    }
+
+  if (0 < ret)
+    {
+      hdr = (uint16_t)raw_len;
+
+#ifdef GACRUX_LZ_VERIFY
+      {
+        FAR uint8_t *chk = malloc(raw_len);
+
+        if (chk)
+          {
+            if (gacrux_lz_decompress(&pkt[TXFW_COMP_HDR_SIZE], ret,
+                                     chk, raw_len) != raw_len ||
+                memcmp(chk, raw, raw_len) != 0)
+              {
+                printf("Compressed packet verify error.\n");
+              }
+
+            free(chk);
+          }
+      }
+#endif
+    }
+  else
+    {
+      hdr = (uint16_t)raw_len | TXFW_COMP_STORED;
+      memcpy(&pkt[TXFW_COMP_HDR_SIZE], raw, raw_len);
+      ret = raw_len;
+    }
+
+  *(uint16_t *)&pkt[0] = hdr; /* Set by little endian. */
+
+  return TXFW_COMP_HDR_SIZE + ret;
+}
+
+static uint32_t elapsed_ms(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  return (uint32_t)((now.tv_sec - start->tv_sec) * 1000 +
+                    (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+static uint32_t elapsed_us(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  return (uint32_t)((now.tv_sec - start->tv_sec) * 1000000 +
+                    (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+static void upload_stat_update(FAR struct gacrux_upload_s *up,
+                               uint32_t pkt_len, uint32_t rtt_us)
+{
+  FAR struct gacrux_upload_stat_s *st = &up->stat;
+
+  st->bytes += pkt_len;
+  st->pkts++;
+
+  if (st->pkts == 1 || rtt_us < st->rtt_min_us)
+    {
+      st->rtt_min_us = rtt_us;
+    }
+
+  if (st->rtt_max_us < rtt_us)
+    {
+      st->rtt_max_us = rtt_us;
+    }
+
+  /* Running average, no need to keep the sum. */
+
+  st->rtt_avg_us += ((int32_t)rtt_us - (int32_t)st->rtt_avg_us) /
+                    (int32_t)st->pkts;
+
+  st->cur_bps = rtt_us ?
+                (uint32_t)((uint64_t)pkt_len * 1000000 / rtt_us) : 0;
+}
+
+static void upload_stat_report(FAR struct gacrux_upload_s *up,
+                               FAR uint32_t *last_ms)
+{
+  FAR struct gacrux_upload_stat_s *st = &up->stat;
+
+  st->avg_bps = st->elapsed_ms ?
+                (uint32_t)((uint64_t)st->bytes * 1000 / st->elapsed_ms) : 0;
+  st->eta_ms  = st->avg_bps ?
+                (uint32_t)((uint64_t)(st->total_bytes - st->bytes) * 1000 /
+                           st->avg_bps) : 0;
+
+  if (!up->stat_cb)
+    {
+      return;
+    }
+
+  if (!st->done && st->elapsed_ms - *last_ms < up->stat_interval_ms)
+    {
+      return;
+    }
+
+  *last_ms = st->elapsed_ms;
+  up->stat_cb(up, st, up->stat_arg);
+}
+
+static int upload_buf_prepare(FAR struct gacrux_upload_s *up)
+{
+  int         i;
+  uint32_t    cmd_sz;
+  FAR uint8_t *buf;
+
+  /* Leave room for the compressed packet header in any mode. */
+
+  cmd_sz = GHIFP_FRAME_SIZE(up->pktzr->preamble_sz +
+                            TXFW_COMP_HDR_SIZE + up->div_sz);
+  /* Command frames may go by SPI DMA, so they come from the DMA
+   * allocator. Their contents need not survive the resize.
+   */
+
+  if (up->cmd_sz < cmd_sz)
+    {
+      for (i=0; i<2; i++)
+        {
+          host_if_dma_free(up->cmd[i]);
+          buf = (FAR uint8_t *)host_if_dma_alloc(cmd_sz);
+          if (!buf)
+            {
+              printf("Failed to allocate divided FW buf.\n");
+              up->cmd[i] = NULL;
+              up->cmd_sz = 0;
+              return -ENOMEM;
+            }
+
+          up->cmd[i] = buf;
+        }
+
+      up->cmd_sz = cmd_sz;
+    }
+
+  if (up->comp == COMPCONF_OPR_NONE)
+    {
+      return 0;
+    }
+
+  if (up->raw_sz < up->div_sz)
+    {
+      buf = realloc(up->raw, up->div_sz);
+      if (!buf)
+        {
+          printf("Failed to allocate compression buf.\n");
+          return -ENOMEM;
+        }
+
+      up->raw    = buf;
+      up->raw_sz = up->div_sz;
+    }
+
+  if (!up->work)
+    {
+      up->work = malloc(GACRUX_LZ_WORK_SZ);
+      if (!up->work)
+        {
+          printf("Failed to allocate compression buf.\n");
+          return -ENOMEM;
+        }
+    }
+
+  return 0;
+}
+
+/* Create the frame of packet No.i in cmd. pos is the number of bytes
+ * taken from the source by the packets before.
+ */
+
+static int upload_build(FAR struct gacrux_upload_s *up, int i,
+                        FAR uint8_t *cmd, uint32_t pos,
+                        FAR uint32_t *pkt_len, FAR uint32_t *opr_len)
+{
+  int                                    ret;
+  FAR const struct gacrux_upload_pktzr_s *pktzr = up->pktzr;
+  FAR uint8_t                            *data;
+  uint32_t                               len;
+  uint32_t                               data_len;
+
+  data = &cmd[GHIFP_OPR_OFFSET + pktzr->preamble_sz];
+
+  len = up->div_sz < (up->src->size - pos) ?
+        up->div_sz : (up->src->size - pos);
+
+  pktzr->preamble(up, i, cmd);
+
+  ret = up->src->read(up->src,
+                      up->comp != COMPCONF_OPR_NONE ? up->raw : data, len);
+  if (ret != len)
+    {
+      printf("File read error. len:%d expected len:%lu\n", ret, len);
+      return -EIO;
+    }
+
+  if (up->comp != COMPCONF_OPR_NONE)
+    {
+      ret = comp_packet_create(data, TXFW_COMP_HDR_SIZE + up->div_sz,
+                               up->raw, len, up->work);
+      if (ret < 0)
+        {
+          printf("Compression error:%d\n", ret);
+          return ret;
+        }
+
+      data_len = ret;
+    }
+  else
+    {
+      data_len = len;
+    }
+
+  *pkt_len = len;
+  *opr_len = pktzr->preamble_sz + data_len;
+
+  cmd[GHIFP_SYNC_OFFSET]                = GHIFP_SYNC;
+  *(uint16_t *)&cmd[GHIFP_OPR_LEN_OFFSET] = *opr_len; /* Set OPC len by little endian. */
+  cmd[GHIFP_OPC_OFFSET]                 = pktzr->opc;
+  cmd[GHIFP_H_CHECKSUM_OFFSET]          = calc_checksum(cmd, 4);
+  cmd[GHIFP_D_CHECKSUM_OFFSET(*opr_len)] =
+    calc_checksum(&cmd[GHIFP_OPR_OFFSET], *opr_len);
+
+  HIF_DBG("Packet(%d/%d) fw part size:%ld\n", i+1, up->stat.total_pkts, len);
+
+  return 0;
+}
+
+static int upload_send(FAR struct gacrux_upload_s *up, FAR uint8_t *cmd,
+                       uint32_t opr_len, FAR uint32_t *res_len)
+{
+  int                  ret;
+  FAR struct host_if_s *host = up->host;
+
+  if (!up->pktzr->split_header)
+    {
+      return host->transaction(host, cmd, GHIFP_FRAME_SIZE(opr_len),
+                               up->recv, up->recv_sz, res_len);
+    }
+
+  /* Send header. The gaps are slept, not spun, and a host which paces
+   * its frames finds them already passed.
+   */
+
+  ret = host->write(host, cmd, GHIFP_HEADER_SIZE);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  usleep(UPLOAD_SPLIT_GAP_MS * 1000);
+
+  /* Send data */
+
+  ret = host->transaction(host, cmd + GHIFP_HEADER_SIZE,
+                          GHIFP_DATA_SIZE(opr_len),
+                          up->recv, up->recv_sz, res_len);
+
+  usleep(UPLOAD_SPLIT_GAP_MS * 1000);
+
+  return ret;
+}
+
+static void upload_set_class(FAR struct host_if_s *host, uint8_t tc)
+{
+  if (host->caps & HOST_IF_CAP_TRAFFIC_CLASS)
+    {
+      host->set_config(host, HOST_IF_SET_CONFIG_REQ_SETCLASS, &tc);
+    }
+}
+
+static int src_file_read(FAR struct gacrux_upload_src_s *src,
+                         FAR uint8_t *buf, uint32_t len)
+{
+  return read(src->fd, buf, len);
+}
+
+static int src_zero_read(FAR struct gacrux_upload_src_s *src,
+                         FAR uint8_t *buf, uint32_t len)
+{
+  memset(buf, 0, len);
+  return len;
+}
+
+static int src_mem_read(FAR struct gacrux_upload_src_s *src,
+                        FAR uint8_t *buf, uint32_t len)
+{
+  if (src->size - src->pos < len)
+    {
+      len = src->size - src->pos;
+    }
+
+  memcpy(buf, &src->buf[src->pos], len);
+  src->pos += len;
+
+  return len;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int gacrux_upload_init(FAR struct gacrux_upload_s *up,
+                       FAR uint8_t *recv, uint32_t recv_sz)
+{
+  if (!up || !recv || !recv_sz)
+    {
+      return -EINVAL;
+    }
+
+  memset(up, 0, sizeof(struct gacrux_upload_s));
+
+  up->recv             = recv;
+  up->recv_sz          = recv_sz;
+  up->comp             = COMPCONF_OPR_NONE;
+  up->stat_interval_ms = UPLOAD_STAT_INTERVAL_MS;
+
+  return 0;
+}
+
+int gacrux_upload_fin(FAR struct gacrux_upload_s *up)
+{
+  if (!up)
+    {
+      return -EINVAL;
+    }
+
+  if (up->cmd[0])
+    {
+      host_if_dma_free(up->cmd[0]);
+    }
+
+  if (up->cmd[1])
+    {
+      host_if_dma_free(up->cmd[1]);
+    }
+
+  if (up->raw)
+    {
+      free(up->raw);
+    }
+
+  if (up->work)
+    {
+      free(up->work);
+    }
+
+  memset(up, 0, sizeof(struct gacrux_upload_s));
+
+  return 0;
+}
+
+int gacrux_upload_run(FAR struct gacrux_upload_s *up)
+{
+  int                                    ret = 0;
+  int                                    i;
+  int                                    loop_num;
+  int                                    retry;
+  int                                    cur = 0;
+  int                                    next_ret;
+  bool                                   pipe;
+  bool                                   built;
+  FAR const struct gacrux_upload_pktzr_s *pktzr;
+  FAR struct gacrux_upload_stat_s        *st = &up->stat;
+  FAR struct host_if_s                   *host;
+  uint32_t                               size;
+  uint32_t                               pos = 0;
+  uint32_t                               pkt_len;
+  uint32_t                               opr_len;
+  uint32_t                               next_pkt_len = 0;
+  uint32_t                               next_opr_len = 0;
+  uint32_t                               res_len;
+  uint32_t                               total_pkt_num;
+  uint32_t                               last_ms = 0;
+  struct timespec                        start;
+  struct timespec                        sent;
+
+  if (!up || !up->host || !up->pktzr || !up->src || !up->div_sz)
+    {
+      return -EINVAL;
+    }
+
+  pktzr = up->pktzr;
+  host  = up->host;
+  size  = up->src->size;
+
+  /* A stored packet is the whole division behind the compression
+   * header, it has to fit in one frame.
+   */
+
+  if (up->comp != COMPCONF_OPR_NONE &&
+      GHIFP_OPR_LEN_MAX <
+        pktzr->preamble_sz + TXFW_COMP_HDR_SIZE + up->div_sz)
+    {
+      printf("Too large division size for compression:%u (max %u)\n",
+             up->div_sz,
+             GHIFP_OPR_LEN_MAX - pktzr->preamble_sz - TXFW_COMP_HDR_SIZE);
+      return -EINVAL;
+    }
+
+  /* When write() only queues the frame, the next packet is created while
+   * the current one is on the wire and Gacrux is checking it.
+   */
+
+  pipe = (host->caps & HOST_IF_CAP_ASYNC_WRITE) && !pktzr->split_header;
+
+  total_pkt_num =
+    (size % up->div_sz) == 0 ?
+    (size / up->div_sz) : (size / up->div_sz) + 1;
+
+  if (pktzr->max_pkt_num < total_pkt_num)
+    {
+      printf("Too many packets:%lu (max %u)\n",
+             total_pkt_num, pktzr->max_pkt_num);
+      return -EFBIG;
+    }
+
+  up->total_pkt_num = (uint16_t)total_pkt_num;
+
+  loop_num = pktzr->loop_num ?
+             pktzr->loop_num(up, total_pkt_num) : total_pkt_num;
+
+  HIF_DBG("%s: size:%lu division size:%u loop_num:%d\n",
+         pktzr->name, size, up->div_sz, loop_num);
+
+  ret = upload_buf_prepare(up);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memset(st, 0, sizeof(struct gacrux_upload_stat_s));
+  st->total_bytes = size;
+  st->total_pkts  = (uint16_t)loop_num;
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  upload_set_class(host, HOST_IF_CLASS_BULK);
+
+  ret = upload_build(up, 0, up->cmd[cur], pos, &pkt_len, &opr_len);
+
+  for (i=0; ret == 0 && i<loop_num; i++)
+    {
+      built    = false;
+      next_ret = 0;
+
+      /* The frame is still in cmd, so it is just sent again on error. */
+
+      for (retry=0; ; retry++)
+        {
+          clock_gettime(CLOCK_REALTIME, &sent);
+          st->wire_bytes += GHIFP_FRAME_SIZE(opr_len);
+
+          if (pipe)
+            {
+              ret = host->write(host, up->cmd[cur],
+                                GHIFP_FRAME_SIZE(opr_len));
+              if (0 <= ret && !built && i+1 < loop_num)
+                {
+                  next_ret = upload_build(up, i+1, up->cmd[cur ^ 1],
+                                          pos + pkt_len,
+                                          &next_pkt_len, &next_opr_len);
+                  built = true;
+                }
+
+              if (0 <= ret)
+                {
+                  ret = host->read(host, up->recv, up->recv_sz);
+                  if (0 <= ret)
+                    {
+                      res_len = ret;
+                      ret     = 0;
+                    }
+                }
+            }
+          else
+            {
+              ret = upload_send(up, up->cmd[cur], opr_len, &res_len);
+            }
+
+          if (ret == 0 || up->retry_max <= retry)
+            {
+              break;
+            }
+
+          printf("Transaction error:%d retry(%d/%d)\n",
+                 ret, retry+1, up->retry_max);
+          st->retries++;
+        }
+
+      if (ret != 0)
+        {
+          printf("Transaction error:%d\n", ret);
+          break;
+        }
+
+      upload_stat_update(up, pkt_len, elapsed_us(&sent));
+
+      if (pktzr->res_check)
+        {
+          ret = pktzr->res_check(up->recv, res_len);
+          if (ret != 0)
+            {
+              printf("Transaction error:%d\n", ret);
+              break;
+            }
+        }
+
+      if (i+1 < loop_num) /* The last one is reported as done. */
+        {
+          st->elapsed_ms = elapsed_ms(&start);
+          upload_stat_report(up, &last_ms);
+
+          if (!built)
+            {
+              next_ret = upload_build(up, i+1, up->cmd[cur ^ 1],
+                                      pos + pkt_len,
+                                      &next_pkt_len, &next_opr_len);
+            }
+
+          ret      = next_ret;
+          pos     += pkt_len;
+          pkt_len  = next_pkt_len;
+          opr_len  = next_opr_len;
+          cur     ^= 1;
+        }
+    }
+
+  upload_set_class(host, HOST_IF_CLASS_CONTROL);
+
+  st->elapsed_ms = elapsed_ms(&start);
+  st->done       = true;
+  upload_stat_report(up, &last_ms);
+
+  if (ret == 0)
+    {
+      printf("Completed all transfers!!\n");
+      printf("%s %lu bytes -> wire %lu bytes (%lu%%), %lu ms, %lu B/s\n",
+             pktzr->name, st->bytes, st->wire_bytes,
+             st->bytes ? st->wire_bytes * 100 / st->bytes : 0,
+             st->elapsed_ms, st->avg_bps);
+    }
+
+  return ret;
+}
+
+void gacrux_upload_stat_print(FAR const struct gacrux_upload_s *up,
+                              FAR const struct gacrux_upload_stat_s *stat,
+                              FAR void *arg)
+{
+  if (arg)
+    {
+      printf("[%s] ", (FAR const char *)arg);
+    }
+
+  printf("%s %lu/%lu bytes (%lu%%) pkt %u/%u, %lu B/s (avg %lu B/s), "
+         "rtt %lu/%lu/%lu us, retry %u, eta %lu ms%s\n",
+         up->pktzr->name, stat->bytes, stat->total_bytes,
+         stat->total_bytes ? stat->bytes * 100 / stat->total_bytes : 100,
+         stat->pkts, stat->total_pkts, stat->cur_bps, stat->avg_bps,
+         stat->rtt_min_us, stat->rtt_avg_us, stat->rtt_max_us,
+         stat->retries, stat->eta_ms, stat->done ? " done" : "");
+}
+
+int gacrux_upload_src_file(FAR struct gacrux_upload_src_s *src,
+                           FAR const char *path)
+{
+  off_t file_sz;
+
+  if (!src || !path)
+    {
+      return -EINVAL;
+    }
+
+  src->fd = open(path, O_RDONLY);
+  if (src->fd < 0)
+    {
+      printf("Failed to open file.\n");
+      return -errno;
+    }
+
+  file_sz = lseek(src->fd, 0, SEEK_END); /* Calc file size. */
+  if (file_sz < 0 || lseek(src->fd, 0, SEEK_SET) < 0)
+    {
+      close(src->fd);
+      src->fd = -1;
+      return -EIO;
+    }
+
+  printf("File size:%lu\n", (uint32_t)file_sz);
+
+  src->size = (uint32_t)file_sz;
+  src->read = src_file_read;
+
+  return 0;
+}
+
+int gacrux_upload_src_zero(FAR struct gacrux_upload_src_s *src,
+                           uint32_t size)
+{
+  if (!src)
+    {
+      return -EINVAL;
+    }
+
+  src->fd   = -1;
+  src->size = size;
+  src->read = src_zero_read;
+
+  return 0;
+}
+
+int gacrux_upload_src_mem(FAR struct gacrux_upload_src_s *src,
+                          FAR const uint8_t *buf, uint32_t size)
+{
+  if (!src || (!buf && size))
+    {
+      return -EINVAL;
+    }
+
+  src->fd   = -1;
+  src->buf  = buf;
+  src->pos  = 0;
+  src->size = size;
+  src->read = src_mem_read;
+
+  return 0;
+}
+
+int gacrux_upload_src_close(FAR struct gacrux_upload_src_s *src)
+{
+  if (!src)
+    {
+      return -EINVAL;
+    }
+
+  if (0 <= src->fd)
+    {
+      close(src->fd);
+      src->fd = -1;
+    }
+
+  return 0;
+}
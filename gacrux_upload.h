@@ -0,0 +1,175 @@
+#ifndef __APPS_EXAMPLES_GHIFP_GACRUX_UPLOAD_H
+#define __APPS_EXAMPLES_GHIFP_GACRUX_UPLOAD_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "host_if.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define UPLOAD_SPLIT_GAP_MS             (5) /* Header/data gap of BININ */
+#define UPLOAD_STAT_INTERVAL_MS         (500) /* Min interval of stat_cb */
+
+                                            /* If correct total size is 4, */
+#define TOTAL_PKT_NUM_TYPE_NORMAL       (0) /* 4, 4, 4, 4      */
+#define TOTAL_PKT_NUM_TYPE_ZERO         (1) /* 0, 0, 0, 0      */
+#define TOTAL_PKT_NUM_TYPE_INVALID      (2) /* 5, 5, 5, 5      */
+#define TOTAL_PKT_NUM_TYPE_SHIFT_PLUS   (3) /* 4, 4, 3, 3      */
+#define TOTAL_PKT_NUM_TYPE_SHIFT_MINUS  (4) /* 4, 4, 5, 5      */
+#define TOTAL_PKT_NUM_TYPE_MAX          (TOTAL_PKT_NUM_TYPE_SHIFT_MINUS)
+
+#define PKT_NO_TYPE_NORMAL              (0) /* 1, 2, 3, 4      */
+#define PKT_NO_TYPE_INCREMENT_FROM_ZERO (1) /* 0, 1, 2, 3      */
+#define PKT_NO_TYPE_NO_INCREMENT        (2) /* 1, 1, 1, 1      */
+#define PKT_NO_TYPE_OVER_INCREMENT      (3) /* 1, 3, 5, 7      */
+#define PKT_NO_TYPE_OVER_TOTAL_NUM      (4) /* 1, 2, 3, 4, "5" */
+#define PKT_NO_TYPE_MAX                 (PKT_NO_TYPE_OVER_TOTAL_NUM)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct gacrux_upload_s;
+
+/* Where packet data comes from. */
+
+struct gacrux_upload_src_s
+{
+  int      (*read)(FAR struct gacrux_upload_src_s *src,
+                   FAR uint8_t *buf, uint32_t len);
+  uint32_t size;
+  int      fd;
+
+  /* Memory source */
+
+  FAR const uint8_t *buf;
+  uint32_t          pos;
+};
+
+/* Progress of an upload, passed to stat_cb. */
+
+struct gacrux_upload_stat_s
+{
+  uint32_t bytes;       /* Packet data sent */
+  uint32_t total_bytes;
+  uint32_t wire_bytes;  /* Whole frames sent, including resent ones */
+  uint16_t pkts;
+  uint16_t total_pkts;
+  uint16_t retries;
+  uint32_t rtt_min_us;  /* Packet send to response */
+  uint32_t rtt_avg_us;
+  uint32_t rtt_max_us;
+  uint32_t cur_bps;     /* Of the last packet */
+  uint32_t avg_bps;
+  uint32_t elapsed_ms;
+  uint32_t eta_ms;
+  bool     done;
+};
+
+typedef void (*gacrux_upload_stat_cb_t)
+  (FAR const struct gacrux_upload_s *up,
+   FAR const struct gacrux_upload_stat_s *stat, FAR void *arg);
+
+/* What one packet looks like on the wire.
+ * | header | preamble(preamble_sz) | packet data | checksum |
+ */
+
+struct gacrux_upload_pktzr_s
+{
+  FAR const char *name;
+  uint8_t        opc;
+  uint16_t       preamble_sz;
+  uint16_t       max_pkt_num;
+  bool           split_header; /* Send header and data separately */
+
+  /* Number of packets to send, default is total_pkt_num. */
+
+  int  (*loop_num)(FAR struct gacrux_upload_s *up, int total_pkt_num);
+
+  /* Fill the preamble of packet No.i (0 origin) in the command frame. */
+
+  void (*preamble)(FAR struct gacrux_upload_s *up, int i,
+                   FAR uint8_t *cmd);
+
+  /* NULL means the response is only waited for. */
+
+  int  (*res_check)(FAR uint8_t *res, uint32_t res_len);
+};
+
+struct gacrux_upload_s
+{
+  FAR struct host_if_s                     *host;
+  FAR const struct gacrux_upload_pktzr_s   *pktzr;
+  FAR struct gacrux_upload_src_s           *src;
+  uint16_t                                 div_sz;
+  uint8_t                                  comp;
+  uint16_t                                 total_pkt_num;
+
+  /* Packetizer parameters */
+
+  uint8_t                                  input;          /* BININ */
+  uint8_t                                  total_pkt_type; /* DBGTXFW */
+  uint8_t                                  pkt_no_type;    /* DBGTXFW */
+
+  /* Buffers, kept over uploads and grown on demand. cmd[1] holds the
+   * next packet while cmd[0] is sent, see HOST_IF_CAP_ASYNC_WRITE.
+   */
+
+  FAR uint8_t                              *cmd[2];
+  uint32_t                                 cmd_sz;
+  FAR uint8_t                              *raw;
+  uint32_t                                 raw_sz;
+  FAR void                                 *work;
+  FAR uint8_t                              *recv;
+  uint32_t                                 recv_sz;
+
+  /* Telemetry. stat_cb is called every stat_interval_ms at most and
+   * once more at the end. NULL means no report.
+   */
+
+  gacrux_upload_stat_cb_t                  stat_cb;
+  FAR void                                 *stat_arg;
+  uint32_t                                 stat_interval_ms;
+  uint8_t                                  retry_max; /* Resend on error */
+
+  /* Result of the last upload */
+
+  struct gacrux_upload_stat_s              stat;
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+extern const struct gacrux_upload_pktzr_s g_upload_pktzr_txfw;
+extern const struct gacrux_upload_pktzr_s g_upload_pktzr_dbgtxfw;
+extern const struct gacrux_upload_pktzr_s g_upload_pktzr_binin;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int gacrux_upload_init(FAR struct gacrux_upload_s *up,
+                       FAR uint8_t *recv, uint32_t recv_sz);
+int gacrux_upload_fin(FAR struct gacrux_upload_s *up);
+int gacrux_upload_run(FAR struct gacrux_upload_s *up);
+void gacrux_upload_stat_print(FAR const struct gacrux_upload_s *up,
+                              FAR const struct gacrux_upload_stat_s *stat,
+                              FAR void *arg);
+
+int gacrux_upload_src_file(FAR struct gacrux_upload_src_s *src,
+                           FAR const char *path);
+int gacrux_upload_src_zero(FAR struct gacrux_upload_src_s *src,
+                           uint32_t size);
+int gacrux_upload_src_mem(FAR struct gacrux_upload_src_s *src,
+                          FAR const uint8_t *buf, uint32_t size);
+int gacrux_upload_src_close(FAR struct gacrux_upload_src_s *src);
+
+#endif /* __APPS_EXAMPLES_GHIFP_GACRUX_UPLOAD_H */
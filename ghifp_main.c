@@ -47,6 +47,7 @@
 #include <errno.h>
 
 #include "gacrux_cmd.h"
+#include "gacrux_session.h"
 #include "host_if_fctry.h"
 
 /****************************************************************************
@@ -75,6 +76,13 @@
 #define CMD_KEY_SETSPICLK         "SETSPICLK"
 #define CMD_KEY_DEBUG_TRANSMIT_FW "DBGTXFW"
 #define CMD_KEY_BINARY_INPUT      "BININ"
+#define CMD_KEY_COMPCONF          "COMPCONF"
+#define CMD_KEY_PROVISION         "PROVISION"
+#define CMD_KEY_PARALLEL_TX_FW    "PTXFW"
+#define CMD_KEY_VERBOSE           "VERBOSE"
+#define CMD_KEY_UARTSYNC          "UARTSYNC"
+#define CMD_KEY_HIFSTAT           "HIFSTAT"
+#define CMD_KEY_CHUNKCONF         "CHUNKCONF"
 
 /****************************************************************************
  * Private Types
@@ -102,7 +110,11 @@ static void help(void)
   printf("\t- %s\n", CMD_KEY_EXECUTE_FW);
   printf("\t- %s [baudrate No] [flow control No]\n", CMD_KEY_UARTCONF);
   printf("\t\te.g. \"ghifp uartconf 6 0\"\n");
+  printf("\t\te.g. \"ghifp uartconf auto 0\"\n");
+  printf("\t- %s\n", CMD_KEY_UARTSYNC);
   printf("\t- %s [speed No]\n", CMD_KEY_I2CCONF);
+  printf("\t- %s [chunk size]\n", CMD_KEY_CHUNKCONF);
+  printf("\t\te.g. \"ghifp chunkconf 2048\"\n");
   printf("\t- %s [binary cpmmand No]\n", CMD_KEY_I2CWRITE);
   printf("\t\te.g. \"ghifp i2cwrite 1 2 3 4 5\"\n");
   printf("\t- %s [binary cpmmand No]\n", CMD_KEY_TEST);
@@ -128,11 +140,22 @@ static void help(void)
   printf("\t- %s [clock No]\n", CMD_KEY_SETSPICLK);
   printf("\t\tIt is only effective when interface type is SPI.\n");
   printf("\t\te.g. \"ghifp setspiclk 2\"\n");
+  printf("\t\te.g. \"ghifp setspiclk auto\"\n");
   printf("\t- %s [virtual_file_sz] [div_sz] [total_pkt_type] [pkt_no_type]\n",
          CMD_KEY_DEBUG_TRANSMIT_FW);
   printf("\t\te.g. \"ghifp dbgtxfw 20480 4086 0 0\n");
   printf("\t- %s [input][path]\n", CMD_KEY_BINARY_INPUT);
   printf("\t\te.g. \"ghifp binin 0 test.bin\"\n");
+  printf("\t- %s [codec No]\n", CMD_KEY_COMPCONF);
+  printf("\t\te.g. \"ghifp compconf 1\"\n");
+  printf("\t- %s [manifest_path]\n", CMD_KEY_PROVISION);
+  printf("\t\te.g. \"ghifp provision /mnt/spif/board.txt\"\n");
+  printf("\t- %s [interface mask] [fw_path]\n", CMD_KEY_PARALLEL_TX_FW);
+  printf("\t\te.g. \"ghifp ptxfw 5 /mnt/spif/test.bin\"\n");
+  printf("\t- %s ([level])\n", CMD_KEY_VERBOSE);
+  printf("\t\te.g. \"ghifp verbose 1\"\n");
+  printf("\t- %s ([clear])\n", CMD_KEY_HIFSTAT);
+  printf("\t\te.g. \"ghifp hifstat 1\"\n");
 
   return;
 }
@@ -227,7 +250,11 @@ int ghifp_cmd_entry(int argc, FAR char *argv[])
   else if (0 == strcasecmp(argv[0], CMD_KEY_UARTCONF))
     {
       /* Change UART configuration */
-      if (argc == 3)
+      if (argc == 3 && 0 == strcasecmp(argv[1], "AUTO"))
+        {
+          ret = gacrux_cmd_uartconf_auto((uint8_t)atoi(argv[2]));
+        }
+      else if (argc == 3)
         {
           ret = gacrux_cmd_uartconf((uint8_t)atoi(argv[1]),
                                     (uint8_t)atoi(argv[2]));
@@ -238,6 +265,19 @@ int ghifp_cmd_entry(int argc, FAR char *argv[])
           ret = -EINVAL;
         }
     }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_UARTSYNC))
+    {
+      /* Find the UART rate of Gacrux again */
+      if (argc == 1)
+        {
+          ret = gacrux_cmd_uart_resync();
+        }
+      else
+        {
+          printf("No need arguments.\n");
+          ret = -EINVAL;
+        }
+    }
   else if (0 == strcasecmp(argv[0], CMD_KEY_I2CCONF))
     {
       /* Change I2C configuration */
@@ -296,7 +336,6 @@ int ghifp_cmd_entry(int argc, FAR char *argv[])
             uint8_t bin_cmd = (uint8_t)atoi(argv[1]);
             ret = gacrux_cmd_spiwrite(bin_cmd, opr, (uint16_t)(argc - 2));
             int res_len = gacrux_cmd_spiread();
-            up_mdelay(5);
 
             if (res_len < 0 && bin_cmd == 0 && (opr[0] == 2))
             {
@@ -433,7 +472,11 @@ int ghifp_cmd_entry(int argc, FAR char *argv[])
   else if (0 == strcasecmp(argv[0], CMD_KEY_SETSPICLK))
     {
       /* Change SPI clock */
-      if (argc == 2)
+      if (argc == 2 && 0 == strcasecmp(argv[1], "AUTO"))
+        {
+          ret = gacrux_cmd_spiclk_train();
+        }
+      else if (argc == 2)
         {
           ret = gacrux_cmd_set_config(HOST_IF_SET_CONFIG_REQ_SETSPICLK,
                                       (void *)argv[1]);
@@ -473,6 +516,92 @@ int ghifp_cmd_entry(int argc, FAR char *argv[])
           ret = -EINVAL;
         }
     }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_CHUNKCONF))
+    {
+      /* Change receive chunk size of I2C and SPI */
+      if (argc == 2)
+        {
+          ret = gacrux_cmd_chunkconf((uint16_t)atoi(argv[1]));
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_COMPCONF))
+    {
+      /* Change compressed transfer configuration */
+      if (argc == 2)
+        {
+          ret = gacrux_cmd_compconf((uint8_t)atoi(argv[1]));
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_PROVISION))
+    {
+      /* Run provisioning manifest */
+      if (argc == 2)
+        {
+          ret = gacrux_session_run(argv[1]);
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_PARALLEL_TX_FW))
+    {
+      /* Transmit and execute FW on several interfaces at once */
+      if (argc == 3)
+        {
+          ret = gacrux_cmd_parallel_tx_fw((uint8_t)atoi(argv[1]), argv[2]);
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_VERBOSE))
+    {
+      /* Set or show log level */
+      if (argc == 2)
+        {
+          ret = gacrux_cmd_set_verbose(atoi(argv[1]));
+        }
+      else if (argc == 1)
+        {
+          printf("Verbose level:%d\n", gacrux_cmd_get_verbose());
+          ret = 0;
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
+  else if (0 == strcasecmp(argv[0], CMD_KEY_HIFSTAT))
+    {
+      /* Show error counters of the interface */
+      if (argc <= 2)
+        {
+          uint8_t clear = (argc == 2) ? (uint8_t)atoi(argv[1]) : 0;
+
+          ret = gacrux_cmd_set_config(HOST_IF_SET_CONFIG_REQ_PRINTSTAT,
+                                      (void *)&clear);
+        }
+      else
+        {
+          printf("The number of arguments is incorrect.\n");
+          ret = -EINVAL;
+        }
+    }
   else
     {
       help();
@@ -0,0 +1,251 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "gacrux_lz.h"
+#include "gacrux_protocol_def.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Host benchmark of compressed TXFW transfer. Each file is cut into
+ * packets of the division size and every packet is built as
+ * comp_packet_create() does, then decoded by the reference decoder as
+ * the peer would and compared. The link time is estimated from the
+ * frame bytes, without response waits.
+ */
+
+#define LZ_BENCH_DIV_SZ_DEFAULT (2048)
+#define LZ_BENCH_UART_BPS       (115200) /* 10 bits per byte */
+#define LZ_BENCH_I2C_BPS        (100000) /* 9 bits per byte */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct lz_bench_s
+{
+  uint32_t raw_bytes;   /* File bytes */
+  uint32_t plain_wire;  /* TXFW frames without compression */
+  uint32_t comp_wire;   /* TXFW frames with compression */
+  uint32_t pkts;
+  uint32_t stored_pkts; /* Sent stored, did not shrink */
+  double   comp_us;
+  double   decomp_us;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static double now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static FAR uint8_t *file_load(FAR const char *path, FAR uint32_t *len)
+{
+  FAR FILE    *fp;
+  FAR uint8_t *buf;
+  long        sz;
+
+  fp = fopen(path, "rb");
+  if (!fp)
+    {
+      return NULL;
+    }
+
+  if (fseek(fp, 0, SEEK_END) != 0 || (sz = ftell(fp)) < 0 ||
+      fseek(fp, 0, SEEK_SET) != 0)
+    {
+      fclose(fp);
+      return NULL;
+    }
+
+  buf = malloc(sz ? sz : 1);
+  if (buf && fread(buf, 1, sz, fp) != (size_t)sz)
+    {
+      free(buf);
+      buf = NULL;
+    }
+
+  fclose(fp);
+  *len = (uint32_t)sz;
+
+  return buf;
+}
+
+/* Compress, decode and compare one packet. Return 0 if it comes back. */
+
+static int lz_bench_packet(FAR struct lz_bench_s *st,
+                           FAR const uint8_t *raw, uint32_t raw_len,
+                           FAR uint8_t *pkt, FAR uint8_t *out,
+                           FAR void *work)
+{
+  int    ret = -ENOSPC;
+  int    len;
+  double t;
+
+  t = now_us();
+  if (1 < raw_len)
+    {
+      ret = gacrux_lz_compress(raw, raw_len, pkt, raw_len - 1, work);
+    }
+  st->comp_us += now_us() - t;
+
+  if (0 < ret)
+    {
+      t   = now_us();
+      len = gacrux_lz_decompress(pkt, ret, out, raw_len);
+      st->decomp_us += now_us() - t;
+    }
+  else
+    {
+      st->stored_pkts++;
+      memcpy(out, raw, raw_len);
+      len = ret = raw_len;
+    }
+
+  st->pkts++;
+  st->plain_wire += TXFW_CMD_SIZE(raw_len);
+  st->comp_wire  += TXFW_CMD_SIZE(TXFW_COMP_HDR_SIZE + ret);
+
+  if (len != (int)raw_len || memcmp(out, raw, raw_len) != 0)
+    {
+      return -EIO;
+    }
+
+  return 0;
+}
+
+static int lz_bench_file(FAR const char *path, uint32_t div_sz,
+                         FAR uint8_t *pkt, FAR uint8_t *out,
+                         FAR void *work)
+{
+  struct lz_bench_s st;
+  FAR uint8_t       *data;
+  uint32_t          len;
+  uint32_t          pos;
+  uint32_t          n;
+  int               ret = 0;
+
+  data = file_load(path, &len);
+  if (!data)
+    {
+      printf("%s: Failed to read.\n", path);
+      return -ENOENT;
+    }
+
+  memset(&st, 0, sizeof(st));
+  st.raw_bytes = len;
+
+  for (pos = 0; pos < len; pos += n)
+    {
+      n = len - pos < div_sz ? len - pos : div_sz;
+      if (lz_bench_packet(&st, data + pos, n, pkt, out, work) < 0)
+        {
+          printf("%s: Round trip error at packet %lu.\n", path,
+                 (unsigned long)st.pkts);
+          ret = -EIO;
+          break;
+        }
+    }
+
+  free(data);
+
+  if (ret < 0 || st.pkts == 0)
+    {
+      return ret;
+    }
+
+  printf("%s: %lu bytes, %lu packets (%lu stored)\n", path,
+         (unsigned long)st.raw_bytes, (unsigned long)st.pkts,
+         (unsigned long)st.stored_pkts);
+  printf("  wire %lu -> %lu bytes, ratio %.1f%%\n",
+         (unsigned long)st.plain_wire, (unsigned long)st.comp_wire,
+         100.0 * st.comp_wire / st.plain_wire);
+  printf("  compress %.1f ms, decompress %.1f ms\n",
+         st.comp_us / 1000, st.decomp_us / 1000);
+  printf("  UART %dbps: %.2f -> %.2f s, I2C %dHz: %.2f -> %.2f s\n",
+         LZ_BENCH_UART_BPS,
+         st.plain_wire * 10.0 / LZ_BENCH_UART_BPS,
+         st.comp_wire * 10.0 / LZ_BENCH_UART_BPS,
+         LZ_BENCH_I2C_BPS,
+         st.plain_wire * 9.0 / LZ_BENCH_I2C_BPS,
+         st.comp_wire * 9.0 / LZ_BENCH_I2C_BPS);
+
+  return 0;
+}
+
+static void usage(FAR const char *prog)
+{
+  printf("Usage: %s [-d division size] file...\n", prog);
+  printf("  division size: 1 to %d, default %d\n",
+         GHIFP_OPR_LEN_MAX - TXFW_PREAMBLE_SIZE - TXFW_COMP_HDR_SIZE,
+         LZ_BENCH_DIV_SZ_DEFAULT);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  uint32_t    div_sz = LZ_BENCH_DIV_SZ_DEFAULT;
+  FAR uint8_t *pkt;
+  FAR uint8_t *out;
+  FAR void    *work;
+  int         fails = 0;
+  int         i = 1;
+
+  if (2 < argc && strcmp(argv[1], "-d") == 0)
+    {
+      div_sz = (uint32_t)atoi(argv[2]);
+      i = 3;
+    }
+
+  if (argc <= i || div_sz == 0 ||
+      GHIFP_OPR_LEN_MAX - TXFW_PREAMBLE_SIZE - TXFW_COMP_HDR_SIZE < div_sz)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+  pkt  = malloc(div_sz);
+  out  = malloc(div_sz);
+  work = malloc(GACRUX_LZ_WORK_SZ);
+  if (!pkt || !out || !work)
+    {
+      printf("No memory.\n");
+      return 1;
+    }
+
+  for (; i < argc; i++)
+    {
+      if (lz_bench_file(argv[i], div_sz, pkt, out, work) < 0)
+        {
+          fails++;
+        }
+    }
+
+  free(pkt);
+  free(out);
+  free(work);
+
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef __APPS_EXAMPLES_GHIFP_HOST_NUTTX_CONFIG_H
+#define __APPS_EXAMPLES_GHIFP_HOST_NUTTX_CONFIG_H
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Stand-in for the NuttX configuration when ghifp sources are built for
+ * the host, see host/Makefile.
+ */
+
+#define FAR
+
+#endif /* __APPS_EXAMPLES_GHIFP_HOST_NUTTX_CONFIG_H */
@@ -11,33 +11,50 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-// #define Bit16Test
-#define HOST_IF_SET_CONFIG_REQ_SETADDR    (1)
-#define HOST_IF_SET_CONFIG_REQ_SETDFS     (2)
-#define HOST_IF_SET_CONFIG_REQ_DBGRECV    (3)
-#define HOST_IF_SET_CONFIG_REQ_SETSLVCONF (4)
-#define HOST_IF_SET_CONFIG_REQ_SETSPICLK  (5)
-
-#define SPEED_UART_4800BPS    (0x0)
-#define SPEED_UART_9600BPS    (0x1)
-#define SPEED_UART_14400BPS   (0x2)
-#define SPEED_UART_19200BPS   (0x3)
-#define SPEED_UART_38400BPS   (0x4)
-#define SPEED_UART_57600BPS   (0x5)
-#define SPEED_UART_115200BPS  (0x6)
-#define SPEED_UART_230400BPS  (0x7)
-#define SPEED_UART_460800BPS  (0x8)
-#define SPEED_UART_921600BPS  (0x9)
-#define SPEED_UART_1000000BPS (0xa)
-#define SPEED_UART_MAX        (SPEED_UART_1000000BPS)
-
-#define SPEED_I2C_100000BPS   (0x0)
-#define SPEED_I2C_400000BPS   (0x1)
-#define SPEED_I2C_MAX         (SPEED_I2C_400000BPS)
+#define HOST_IF_SET_CONFIG_REQ_SETADDR     (1)
+#define HOST_IF_SET_CONFIG_REQ_SETDFS      (2)
+#define HOST_IF_SET_CONFIG_REQ_DBGRECV     (3)
+#define HOST_IF_SET_CONFIG_REQ_SETSLVCONF  (4)
+#define HOST_IF_SET_CONFIG_REQ_SETSPICLK   (5)
+#define HOST_IF_SET_CONFIG_REQ_SETFLOWCTRL (6)
+#define HOST_IF_SET_CONFIG_REQ_GETSLVCONF  (7)
+#define HOST_IF_SET_CONFIG_REQ_RESYNC      (8)
+#define HOST_IF_SET_CONFIG_REQ_PRINTSTAT   (9)
+#define HOST_IF_SET_CONFIG_REQ_SETCHUNK    (10)
+#define HOST_IF_SET_CONFIG_REQ_GETSPICLK   (11)
+#define HOST_IF_SET_CONFIG_REQ_SETCLASS    (12)
+
+#define SPEED_UART_4800BPS     (0x0)
+#define SPEED_UART_9600BPS     (0x1)
+#define SPEED_UART_14400BPS    (0x2)
+#define SPEED_UART_19200BPS    (0x3)
+#define SPEED_UART_38400BPS    (0x4)
+#define SPEED_UART_57600BPS    (0x5)
+#define SPEED_UART_115200BPS   (0x6)
+#define SPEED_UART_230400BPS   (0x7)
+#define SPEED_UART_460800BPS   (0x8)
+#define SPEED_UART_921600BPS   (0x9)
+#define SPEED_UART_1000000BPS  (0xa)
+#define SPEED_UART_2000000BPS  (0xb)
+#define SPEED_UART_3000000BPS  (0xc)
+#define SPEED_UART_4000000BPS  (0xd)
+#define SPEED_UART_5000000BPS  (0xe)
+#define SPEED_UART_6000000BPS  (0xf)
+#define SPEED_UART_7000000BPS  (0x10)
+#define SPEED_UART_8000000BPS  (0x11)
+#define SPEED_UART_9000000BPS  (0x12)
+#define SPEED_UART_10000000BPS (0x13)
+#define SPEED_UART_MAX         (SPEED_UART_10000000BPS)
+
+#define SPEED_I2C_100000BPS   (0x0) /* Standard-mode */
+#define SPEED_I2C_1000000BPS  (0x1) /* Fast-mode Plus */
+#define SPEED_I2C_3400000BPS  (0x2) /* High-speed mode */
+#define SPEED_I2C_MAX         (SPEED_I2C_3400000BPS)
 
 #define DFS_SPI_8   (0x0)
 #define DFS_SPI_16  (0x1)
-#define DFS_SPI_MAX (DFS_SPI_16)
+#define DFS_SPI_32  (0x2)
+#define DFS_SPI_MAX (DFS_SPI_32)
 
 #define SPEED_SPI_1300000BPS  (0x0)
 #define SPEED_SPI_2600000BPS  (0x1)
@@ -47,7 +64,20 @@
 #define SPEED_SPI_9750000BPS  (0x5)
 #define SPEED_SPI_13000000BPS (0x6)
 
-#define SPEED_SPI_MAX         (SPEED_SPI_9750000BPS)
+#define SPEED_SPI_MAX         (SPEED_SPI_13000000BPS)
+
+#define HOST_IF_CAP_ASYNC_WRITE  (1 << 0) /* write() returns when queued */
+#define HOST_IF_CAP_TRAFFIC_CLASS (1 << 1) /* Takes SETCLASS */
+
+/* Transfer classes of SETCLASS, the host may run each at other settings. */
+
+#define HOST_IF_CLASS_CONTROL    (0) /* Commands and wake-up, conservative */
+#define HOST_IF_CLASS_BULK       (1) /* Firmware and stream data, fastest */
+
+#define HOST_IF_VERBOSE_QUIET    (0) /* Errors and results only */
+#define HOST_IF_VERBOSE_PROGRESS (1) /* + Transfer progress */
+#define HOST_IF_VERBOSE_DEBUG    (2) /* + Every packet and transaction */
+#define HOST_IF_VERBOSE_MAX      (HOST_IF_VERBOSE_DEBUG)
 
 /****************************************************************************
  * Public Types
@@ -67,6 +97,7 @@ struct host_if_s
                    FAR uint8_t *data, uint32_t sz);
   int (*set_config)(FAR struct host_if_s *thiz,
                     uint32_t req, FAR void *arg);
+  uint32_t caps; /* HOST_IF_CAP_XXX */
 };
 
 typedef void (*hostif_evt_cb)(FAR uint8_t *dataframe, int32_t len);
@@ -26,15 +26,24 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define MQUEUE_NAME    "ghifp_mq"
+#define MQUEUE_NAME    "ghifp_mq%d" /* One queue per channel */
+#define MQUEUE_NAME_SZ (16)
 #define MQUEUE_MSG_MAX (8)
 #define MQUEUE_MODE    0666
 
-#define RECV_TIMEOUT_SEC (2) /* Change from 3 for spi wake up test */
-
-#define BUS_REQ (PIN_PWM0)
-// #define BUS_REQ (PIN_SEN_IRQ_IN)
-// #define BUS_REQ (PIN_EMMC_DATA3)
+/* Bus request pin of each target. When both are the same pin, the request
+ * goes to the bus selected by g_hif_type, or by bus_req_set_route(), so
+ * I2C and SPI cannot be used at the same time.
+ */
+
+#ifndef BUS_REQ_I2C
+#  define BUS_REQ_I2C (PIN_PWM0)
+#endif
+#ifndef BUS_REQ_SPI
+#  define BUS_REQ_SPI (PIN_PWM0)
+// #  define BUS_REQ_SPI (PIN_SEN_IRQ_IN)
+// #  define BUS_REQ_SPI (PIN_EMMC_DATA3)
+#endif
  /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -43,6 +52,7 @@ struct dataframe_s
 {
   uint8_t  *buf;
   uint32_t sz;
+  int      err; /* Receive error given to the waiting transaction */
 };
 
 /****************************************************************************
@@ -52,7 +62,13 @@ struct dataframe_s
 static sem_t g_i2c_bus_req_sem;
 static sem_t g_spi_bus_req_sem;
 
-static enum host_if_state_e g_host_if_state = HOST_IF_STATE_IDLE;
+static int g_host_if_verbose = HOST_IF_VERBOSE_QUIET;
+static volatile int g_bus_req_route = BUS_REQ_ROUTE_HIF;
+
+static enum host_if_state_e g_host_if_state[HOST_IF_BS_CH_NUM] =
+{
+  HOST_IF_STATE_IDLE, HOST_IF_STATE_IDLE, HOST_IF_STATE_IDLE
+};
 
 /* Warning!! Interdependence. */
 #include "host_if_fctry.h"
@@ -65,8 +81,14 @@ extern enum host_if_fctry_type_e g_hif_type;
 static int bus_req_handler(int irq, FAR void *context, FAR void *arg)
 {
   int ret;
+  int type = g_bus_req_route;
 
-  if (g_hif_type == HOST_IF_FCTRY_TYPE_I2C)
+  if (type == BUS_REQ_ROUTE_HIF)
+    {
+      type = g_hif_type;
+    }
+
+  if (type == HOST_IF_FCTRY_TYPE_I2C)
   {
     // printf("!!!bus!!!\n");
     ret = sem_post(&g_i2c_bus_req_sem);
@@ -76,7 +98,7 @@ static int bus_req_handler(int irq, FAR void *context, FAR void *arg)
     }
     }
 
-  if (g_hif_type == HOST_IF_FCTRY_TYPE_SPI)
+  if (type == HOST_IF_FCTRY_TYPE_SPI)
     {
       // printf("bus! %d\n", g_spi_bus_req_sem.semcount);
       ret = sem_post(&g_spi_bus_req_sem);
@@ -89,11 +111,35 @@ static int bus_req_handler(int irq, FAR void *context, FAR void *arg)
   return 0;
 }
 
+static int bus_req_i2c_handler(int irq, FAR void *context, FAR void *arg)
+{
+  return sem_post(&g_i2c_bus_req_sem);
+}
+
+static int bus_req_spi_handler(int irq, FAR void *context, FAR void *arg)
+{
+  return sem_post(&g_spi_bus_req_sem);
+}
+
+static int df_queue_open(int ch, int oflag)
+{
+  char name[MQUEUE_NAME_SZ];
+
+  if (ch < 0 || HOST_IF_BS_CH_NUM <= ch)
+    {
+      return -EINVAL;
+    }
+
+  snprintf(name, sizeof(name), MQUEUE_NAME, ch);
+
+  return (int)mq_open(name, oflag);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-int push_dataframe(FAR uint8_t *df, uint32_t df_len)
+int push_dataframe(int ch, FAR uint8_t *df, uint32_t df_len)
 {
   int                ret;
   mqd_t              mqd;
@@ -104,7 +150,7 @@ int push_dataframe(FAR uint8_t *df, uint32_t df_len)
       return -EINVAL;
     }
 
-  mqd = mq_open(MQUEUE_NAME, O_WRONLY);
+  mqd = df_queue_open(ch, O_WRONLY);
   if (mqd < 0)
     {
       printf("Failed to open queue for dataframe.\n");
@@ -146,7 +192,51 @@ errout:
   return ret;
 }
 
-int pop_dataframe(FAR uint8_t *buf, uint32_t sz, FAR uint32_t *df_len)
+/* Wake the waiting transaction with err instead of letting it time out,
+ * when the receive task has given up the response.
+ */
+
+int push_dataframe_error(int ch, int err)
+{
+  int                ret;
+  mqd_t              mqd;
+  struct dataframe_s one_dataframe = {0};
+
+  if (0 <= err)
+    {
+      return -EINVAL;
+    }
+
+  mqd = df_queue_open(ch, O_WRONLY);
+  if (mqd < 0)
+    {
+      printf("Failed to open queue for dataframe.\n");
+      return (int)mqd;
+    }
+
+  one_dataframe.err = err;
+  ret = mq_send(mqd,
+                (FAR const char*)&one_dataframe,
+                sizeof(one_dataframe), 0);
+  if (ret < 0)
+    {
+      printf("Failed to push receive error.\n");
+    }
+
+  mq_close(mqd);
+
+  return ret;
+}
+
+int pop_dataframe(int ch, FAR uint8_t *buf, uint32_t sz,
+                  FAR uint32_t *df_len)
+{
+  return pop_dataframe_timeout(ch, buf, sz, df_len,
+                               RECV_TIMEOUT_SEC * 1000);
+}
+
+int pop_dataframe_timeout(int ch, FAR uint8_t *buf, uint32_t sz,
+                          FAR uint32_t *df_len, uint32_t timeout_ms)
 {
   int                ret;
   mqd_t              mqd;
@@ -158,7 +248,7 @@ int pop_dataframe(FAR uint8_t *buf, uint32_t sz, FAR uint32_t *df_len)
       return -EINVAL;
     }
 
-  mqd = mq_open(MQUEUE_NAME, O_RDONLY);
+  mqd = df_queue_open(ch, O_RDONLY);
   if (mqd < 0)
     {
       printf("Failed to open queue for dataframe.\n");
@@ -171,14 +261,28 @@ int pop_dataframe(FAR uint8_t *buf, uint32_t sz, FAR uint32_t *df_len)
       return ret;
     }
 
-  abs_time.tv_sec += RECV_TIMEOUT_SEC;
+  abs_time.tv_sec  += timeout_ms / 1000;
+  abs_time.tv_nsec += (timeout_ms % 1000) * 1000000;
+  if (1000000000 <= abs_time.tv_nsec)
+    {
+      abs_time.tv_sec++;
+      abs_time.tv_nsec -= 1000000000;
+    }
 
   ret = mq_timedreceive(mqd,
                         (FAR char*)&one_dataframe,
                         sizeof(one_dataframe), 0, &abs_time);
   if (ret < 0)
     {
-      printf("Failed to pop dataframe.\n");
+      ret = -errno;
+      HIF_DBG("Failed to pop dataframe:%d\n", ret);
+      goto errout;
+    }
+
+  if (one_dataframe.err < 0)
+    {
+      ret = one_dataframe.err;
+      HIF_DBG("Receive error:%d\n", ret);
       goto errout;
     }
 
@@ -203,20 +307,28 @@ errout:
 
 int create_df_queue(void)
 {
+  int            ch;
   mqd_t          mqd;
   struct mq_attr mq_attr;
+  char           name[MQUEUE_NAME_SZ];
 
   mq_attr.mq_maxmsg  = MQUEUE_MSG_MAX;
   mq_attr.mq_msgsize = sizeof(struct dataframe_s);
   mq_attr.mq_flags   = 0;
 
-  mqd = mq_open(MQUEUE_NAME, (O_RDWR | O_CREAT), MQUEUE_MODE, &mq_attr);
-  if (mqd < 0)
+  for (ch=0; ch<HOST_IF_BS_CH_NUM; ch++)
     {
-      printf("Failed to create queue for dataframe.\n");
-      return (int)mqd;
+      snprintf(name, sizeof(name), MQUEUE_NAME, ch);
+
+      mqd = mq_open(name, (O_RDWR | O_CREAT), MQUEUE_MODE, &mq_attr);
+      if (mqd < 0)
+        {
+          printf("Failed to create queue for dataframe.\n");
+          delete_df_queue();
+          return (int)mqd;
+        }
+      mq_close(mqd);
     }
-  mq_close(mqd);
 
   printf("Queue for dataframe is created.\n");
 
@@ -225,7 +337,14 @@ int create_df_queue(void)
 
 int delete_df_queue(void)
 {
-  mq_unlink(MQUEUE_NAME);
+  int  ch;
+  char name[MQUEUE_NAME_SZ];
+
+  for (ch=0; ch<HOST_IF_BS_CH_NUM; ch++)
+    {
+      snprintf(name, sizeof(name), MQUEUE_NAME, ch);
+      mq_unlink(name);
+    }
 
   return 0;
 }
@@ -304,11 +423,12 @@ int bus_req_init(void)
       return ret;
     }
 
-  ret = cxd56_gpioint_config(BUS_REQ,
+  ret = cxd56_gpioint_config(BUS_REQ_I2C,
                              GPIOINT_TOGGLE_MODE_MASK     |
                              GPIOINT_NOISE_FILTER_DISABLE |
                              GPIOINT_LEVEL_HIGH,
-                             bus_req_handler,
+                             bus_req_is_shared() ?
+                             bus_req_handler : bus_req_i2c_handler,
                              NULL);
   if (ret < 0)
     {
@@ -316,14 +436,36 @@ int bus_req_init(void)
       return ret;
     }
 
-  cxd56_gpioint_enable(BUS_REQ);
+  if (!bus_req_is_shared())
+    {
+      ret = cxd56_gpioint_config(BUS_REQ_SPI,
+                                 GPIOINT_TOGGLE_MODE_MASK     |
+                                 GPIOINT_NOISE_FILTER_DISABLE |
+                                 GPIOINT_LEVEL_HIGH,
+                                 bus_req_spi_handler,
+                                 NULL);
+      if (ret < 0)
+        {
+          printf("cxd56_gpioint_config : %d\n", ret);
+          return ret;
+        }
+
+      cxd56_gpioint_enable(BUS_REQ_SPI);
+    }
+
+  cxd56_gpioint_enable(BUS_REQ_I2C);
 
   return 0;
 }
 
 int bus_req_deinit(void)
 {
-  cxd56_gpioint_disable(BUS_REQ);
+  cxd56_gpioint_disable(BUS_REQ_I2C);
+
+  if (!bus_req_is_shared())
+    {
+      cxd56_gpioint_disable(BUS_REQ_SPI);
+    }
 
   sem_destroy(&g_i2c_bus_req_sem);
   sem_destroy(&g_spi_bus_req_sem);
@@ -359,14 +501,112 @@ int bus_req_wait_spi(void)
   return ret;
 }
 
-int set_host_if_state(enum host_if_state_e state)
+/* Wait for a bus request within a frame, Gacrux may have dropped the
+ * frame. Returns -ETIMEDOUT after timeout_ms.
+ */
+
+int bus_req_timedwait_spi(uint32_t timeout_ms)
+{
+  int             ret;
+  struct timespec abs_time;
+
+  clock_gettime(CLOCK_REALTIME, &abs_time);
+  abs_time.tv_sec  += timeout_ms / 1000;
+  abs_time.tv_nsec += (timeout_ms % 1000) * 1000000;
+  if (1000000000 <= abs_time.tv_nsec)
+    {
+      abs_time.tv_sec++;
+      abs_time.tv_nsec -= 1000000000;
+    }
+
+  ret = sem_timedwait(&g_spi_bus_req_sem, &abs_time);
+  if (ret != 0)
+    {
+      ret = -errno;
+      if (ret != -ETIMEDOUT)
+        {
+          printf("Failed to take semaphore:%d\n", ret);
+        }
+    }
+
+  return ret;
+}
+
+bool bus_req_is_shared(void)
+{
+  return BUS_REQ_I2C == BUS_REQ_SPI;
+}
+
+/* Route a shared bus request pin to the given host_if_fctry_type_e
+ * instead of the interface in use, BUS_REQ_ROUTE_HIF to go back.
+ */
+
+void bus_req_set_route(int type)
 {
-  g_host_if_state = state;
-  printf("Host I/F state:%d\n", g_host_if_state);
+  g_bus_req_route = type;
+}
+
+int set_host_if_state(int ch, enum host_if_state_e state)
+{
+  if (ch < 0 || HOST_IF_BS_CH_NUM <= ch)
+    {
+      return -EINVAL;
+    }
+
+  g_host_if_state[ch] = state;
+  HIF_DBG("Host I/F state(%d):%d\n", ch, g_host_if_state[ch]);
   return 0;
 }
 
-enum host_if_state_e get_host_if_state(void)
+enum host_if_state_e get_host_if_state(int ch)
 {
-  return g_host_if_state;
+  if (ch < 0 || HOST_IF_BS_CH_NUM <= ch)
+    {
+      return HOST_IF_STATE_IDLE;
+    }
+
+  return g_host_if_state[ch];
+}
+
+int host_if_set_verbose(int level)
+{
+  if (level < HOST_IF_VERBOSE_QUIET || HOST_IF_VERBOSE_MAX < level)
+    {
+      return -EINVAL;
+    }
+
+  g_host_if_verbose = level;
+  return 0;
+}
+
+int host_if_get_verbose(void)
+{
+  return g_host_if_verbose;
+}
+
+void rx_stat_frame(FAR struct host_if_rx_stat_s *stat, uint32_t len,
+                   FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  stat->frames++;
+  stat->bytes += len;
+  stat->rx_us += (now.tv_sec - start->tv_sec) * 1000000 +
+                 (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+void rx_stat_print(FAR const struct host_if_rx_stat_s *stat,
+                   uint32_t chunk)
+{
+  printf("RX chunk:%lu frames:%lu bytes:%lu bus req:%lu time:%lu us",
+         chunk, stat->frames, stat->bytes, stat->bus_reqs, stat->rx_us);
+  if (stat->rx_us)
+    {
+      printf(" (%lu B/s)",
+             (uint32_t)((uint64_t)stat->bytes * 1000000 / stat->rx_us));
+    }
+
+  printf("\n");
 }
@@ -5,7 +5,9 @@
  * Included Files
  ****************************************************************************/
 
+#include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <sched.h>
 
 /****************************************************************************
@@ -14,6 +16,28 @@
 
 #define LOCAL_BUFF_SZ (4096 + 16)
 
+#define RECV_TIMEOUT_SEC (2) /* Change from 3 for spi wake up test */
+
+#define BUS_REQ_ROUTE_HIF (-1) /* Shared bus request follows g_hif_type */
+
+/* Response channel of each transport, same order as host_if_fctry_type_e */
+
+#define HOST_IF_BS_CH_UART (0)
+#define HOST_IF_BS_CH_I2C  (1)
+#define HOST_IF_BS_CH_SPI  (2)
+#define HOST_IF_BS_CH_NUM  (3)
+
+/* Per transaction log, shown only in HOST_IF_VERBOSE_DEBUG. */
+
+#define HIF_DBG(...)                                     \
+do                                                       \
+  {                                                      \
+    if (HOST_IF_VERBOSE_DEBUG <= host_if_get_verbose())  \
+      {                                                  \
+        printf(__VA_ARGS__);                             \
+      }                                                  \
+  } while(0)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -24,12 +48,26 @@ enum host_if_state_e
   HOST_IF_STATE_WAIT_RESPONSE
 };
 
+/* Frames received by bus request, to compare chunk sizes. */
+
+struct host_if_rx_stat_s
+{
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t bus_reqs; /* One per chunk */
+  uint32_t rx_us;    /* From the first bus request to the end of frame */
+};
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-int push_dataframe(FAR uint8_t *df, uint32_t df_len);
-int pop_dataframe(FAR uint8_t *buf, uint32_t sz, FAR uint32_t *df_len);
+int push_dataframe(int ch, FAR uint8_t *df, uint32_t df_len);
+int push_dataframe_error(int ch, int err);
+int pop_dataframe(int ch, FAR uint8_t *buf, uint32_t sz,
+                  FAR uint32_t *df_len);
+int pop_dataframe_timeout(int ch, FAR uint8_t *buf, uint32_t sz,
+                          FAR uint32_t *df_len, uint32_t timeout_ms);
 int create_df_queue(void);
 int delete_df_queue(void);
 int start_task(FAR const char *name, main_t entry, FAR const char *argv[]);
@@ -40,7 +78,16 @@ int bus_req_init(void);
 int bus_req_deinit(void);
 int bus_req_wait_i2c(void);
 int bus_req_wait_spi(void);
-int set_host_if_state(enum host_if_state_e state);
-enum host_if_state_e get_host_if_state(void);
+int bus_req_timedwait_spi(uint32_t timeout_ms);
+bool bus_req_is_shared(void);
+void bus_req_set_route(int type);
+int set_host_if_state(int ch, enum host_if_state_e state);
+enum host_if_state_e get_host_if_state(int ch);
+int host_if_set_verbose(int level);
+int host_if_get_verbose(void);
+void rx_stat_frame(FAR struct host_if_rx_stat_s *stat, uint32_t len,
+                   FAR const struct timespec *start);
+void rx_stat_print(FAR const struct host_if_rx_stat_s *stat,
+                   uint32_t chunk);
 
 #endif /* __APPS_EXAMPLES_GHIFP_HOST_IF_BS_H */
@@ -0,0 +1,268 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "host_if_bs.h"
+#include "host_if_bus.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int64_t ts_diff_us(FAR const struct timespec *a,
+                          FAR const struct timespec *b)
+{
+  return (int64_t)(a->tv_sec - b->tv_sec) * 1000000 +
+         (a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+static bool req_expired(FAR const struct host_if_bus_req_s *req,
+                        FAR const struct timespec *now)
+{
+  return req->has_deadline && ts_diff_us(now, &req->deadline) >= 0;
+}
+
+/* true when a should get the bus before b. */
+
+static bool req_before(FAR const struct host_if_bus_req_s *a,
+                       FAR const struct host_if_bus_req_s *b,
+                       FAR const struct timespec *now)
+{
+  bool a_exp = req_expired(a, now);
+  bool b_exp = req_expired(b, now);
+
+  if (a_exp != b_exp)
+    {
+      return a_exp;
+    }
+
+  if (!a_exp && a->prio != b->prio)
+    {
+      return a->prio > b->prio;
+    }
+
+  if (a->has_deadline != b->has_deadline)
+    {
+      return a->has_deadline;
+    }
+
+  return a->has_deadline && ts_diff_us(&a->deadline, &b->deadline) < 0;
+}
+
+static FAR struct host_if_bus_req_s *bus_pick(FAR struct host_if_bus_s *bus)
+{
+  FAR struct host_if_bus_req_s *req;
+  FAR struct host_if_bus_req_s *best = bus->waiters;
+  struct timespec              now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  for (req=bus->waiters; req; req=req->next)
+    {
+      if (req_before(req, best, &now))
+        {
+          best = req;
+        }
+    }
+
+  return best;
+}
+
+static void bus_unlink(FAR struct host_if_bus_s *bus,
+                       FAR struct host_if_bus_req_s *req)
+{
+  FAR struct host_if_bus_req_s **pp;
+
+  for (pp=&bus->waiters; *pp; pp=&(*pp)->next)
+    {
+      if (*pp == req)
+        {
+          *pp = req->next;
+          break;
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int host_if_bus_init(FAR struct host_if_bus_s *bus)
+{
+  int ret;
+
+  if (!bus)
+    {
+      return -EINVAL;
+    }
+
+  memset(bus, 0, sizeof(struct host_if_bus_s));
+
+  ret = pthread_mutex_init(&bus->lock, NULL);
+  if (ret != 0)
+    {
+      return -ret;
+    }
+
+  ret = pthread_cond_init(&bus->cond, NULL);
+  if (ret != 0)
+    {
+      pthread_mutex_destroy(&bus->lock);
+      return -ret;
+    }
+
+  return 0;
+}
+
+int host_if_bus_fin(FAR struct host_if_bus_s *bus)
+{
+  if (!bus)
+    {
+      return -EINVAL;
+    }
+
+  pthread_cond_destroy(&bus->cond);
+  pthread_mutex_destroy(&bus->lock);
+
+  return 0;
+}
+
+/* Wait for the bus. deadline_us is the longest wait the client can
+ * stand, HOST_IF_BUS_NO_DEADLINE for none.
+ */
+
+int host_if_bus_acquire(FAR struct host_if_bus_s *bus, int prio,
+                        uint32_t deadline_us)
+{
+  struct host_if_bus_req_s req;
+  struct timespec          start;
+  struct timespec          now;
+  uint32_t                 wait_us;
+
+  if (!bus)
+    {
+      return -EINVAL;
+    }
+
+  clock_gettime(CLOCK_REALTIME, &start);
+
+  memset(&req, 0, sizeof(req));
+  req.pid          = getpid();
+  req.prio         = prio;
+  req.has_deadline = deadline_us != HOST_IF_BUS_NO_DEADLINE;
+  req.deadline     = start;
+  req.deadline.tv_sec  += deadline_us / 1000000;
+  req.deadline.tv_nsec += (deadline_us % 1000000) * 1000;
+  if (1000000000 <= req.deadline.tv_nsec)
+    {
+      req.deadline.tv_sec++;
+      req.deadline.tv_nsec -= 1000000000;
+    }
+
+  pthread_mutex_lock(&bus->lock);
+
+  req.next     = bus->waiters;
+  bus->waiters = &req;
+
+  while (bus->busy || bus_pick(bus) != &req)
+    {
+      pthread_cond_wait(&bus->cond, &bus->lock);
+    }
+
+  bus_unlink(bus, &req);
+  bus->busy  = true;
+  bus->owner = req.pid;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  bus->grants++;
+  if (req_expired(&req, &now))
+    {
+      bus->misses++;
+    }
+
+  wait_us = (uint32_t)ts_diff_us(&now, &start);
+  if (bus->wait_max_us < wait_us)
+    {
+      bus->wait_max_us = wait_us;
+    }
+
+  pthread_mutex_unlock(&bus->lock);
+
+  return 0;
+}
+
+void host_if_bus_release(FAR struct host_if_bus_s *bus)
+{
+  pthread_mutex_lock(&bus->lock);
+  bus->busy  = false;
+  bus->owner = 0;
+  pthread_cond_broadcast(&bus->cond);
+  pthread_mutex_unlock(&bus->lock);
+}
+
+/* Stop a task which may hold or wait for the bus. The task cannot enter
+ * or leave host_if_bus_acquire() while the lock is held here, so its
+ * request is unlinked from the still valid stack before the task goes.
+ */
+
+void host_if_bus_stop_task(FAR struct host_if_bus_s *bus, pid_t pid)
+{
+  FAR struct host_if_bus_req_s *req;
+  FAR struct host_if_bus_req_s *next;
+
+  if (pid <= 0)
+    {
+      return;
+    }
+
+  pthread_mutex_lock(&bus->lock);
+
+  for (req=bus->waiters; req; req=next)
+    {
+      next = req->next;
+      if (req->pid == pid)
+        {
+          bus_unlink(bus, req);
+        }
+    }
+
+  if (bus->busy && bus->owner == pid)
+    {
+      bus->busy  = false;
+      bus->owner = 0;
+    }
+
+  stop_task(pid);
+
+  pthread_cond_broadcast(&bus->cond);
+  pthread_mutex_unlock(&bus->lock);
+}
+
+void host_if_bus_print(FAR struct host_if_bus_s *bus, bool clear)
+{
+  pthread_mutex_lock(&bus->lock);
+
+  printf("Bus grants:%lu deadline misses:%lu max wait:%lu us\n",
+         bus->grants, bus->misses, bus->wait_max_us);
+
+  if (clear)
+    {
+      bus->grants      = 0;
+      bus->misses      = 0;
+      bus->wait_max_us = 0;
+    }
+
+  pthread_mutex_unlock(&bus->lock);
+}
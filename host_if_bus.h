@@ -0,0 +1,72 @@
+#ifndef __APPS_EXAMPLES_GHIFP_HOST_IF_BUS_H
+#define __APPS_EXAMPLES_GHIFP_HOST_IF_BUS_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define HOST_IF_BUS_PRIO_LOW    (0) /* Bulk transfers */
+#define HOST_IF_BUS_PRIO_NORMAL (1)
+#define HOST_IF_BUS_PRIO_HIGH   (2) /* Bus recovery */
+
+#define HOST_IF_BUS_NO_DEADLINE (0)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One waiting client, lives on the stack of host_if_bus_acquire(). */
+
+struct host_if_bus_req_s
+{
+  FAR struct host_if_bus_req_s *next;
+  pid_t                        pid;
+  int                          prio;
+  bool                         has_deadline;
+  struct timespec              deadline;
+};
+
+/* Bus shared by clients. The bus goes to a client whose deadline has
+ * passed first, then to the highest priority, then to the earliest
+ * deadline. A transfer holds the bus only for itself, so long frames
+ * are split into transfers to let others in between.
+ */
+
+struct host_if_bus_s
+{
+  pthread_mutex_t              lock;
+  pthread_cond_t               cond;
+  bool                         busy;
+  pid_t                        owner;       /* Valid while busy */
+  FAR struct host_if_bus_req_s *waiters;
+
+  /* Statistics */
+
+  uint32_t                     grants;
+  uint32_t                     misses;      /* Granted after deadline */
+  uint32_t                     wait_max_us;
+};
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int host_if_bus_init(FAR struct host_if_bus_s *bus);
+int host_if_bus_fin(FAR struct host_if_bus_s *bus);
+int host_if_bus_acquire(FAR struct host_if_bus_s *bus, int prio,
+                        uint32_t deadline_us);
+void host_if_bus_release(FAR struct host_if_bus_s *bus);
+void host_if_bus_stop_task(FAR struct host_if_bus_s *bus, pid_t pid);
+void host_if_bus_print(FAR struct host_if_bus_s *bus, bool clear);
+
+#endif /* __APPS_EXAMPLES_GHIFP_HOST_IF_BUS_H */
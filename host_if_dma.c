@@ -0,0 +1,68 @@
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "host_if_dma.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define DMA_ROUNDUP(sz) \
+  (((sz) + HOST_IF_DMA_ALIGN - 1) & ~(size_t)(HOST_IF_DMA_ALIGN - 1))
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint32_t g_dma_bufs;
+static uint32_t g_dma_fails;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Buffer which a DMA may read or write. The size is rounded up so that
+ * the buffer never shares an aligned block with other data.
+ */
+
+FAR void *host_if_dma_alloc(size_t size)
+{
+  FAR void *buf;
+
+  if (size == 0)
+    {
+      return NULL;
+    }
+
+  buf = memalign(HOST_IF_DMA_ALIGN, DMA_ROUNDUP(size));
+  if (!buf)
+    {
+      g_dma_fails++;
+      return NULL;
+    }
+
+  g_dma_bufs++;
+
+  return buf;
+}
+
+void host_if_dma_free(FAR void *buf)
+{
+  if (buf)
+    {
+      g_dma_bufs--;
+      free(buf);
+    }
+}
+
+void host_if_dma_print(void)
+{
+  printf("DMA buffers:%lu alloc failures:%lu\n", g_dma_bufs, g_dma_fails);
+}
@@ -0,0 +1,32 @@
+#ifndef __APPS_EXAMPLES_GHIFP_HOST_IF_DMA_H
+#define __APPS_EXAMPLES_GHIFP_HOST_IF_DMA_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Start address and size alignment of DMA buffers. Wide enough for a
+ * 32-bit DMA word and for a cache line on cores that have a data cache.
+ */
+
+#define HOST_IF_DMA_ALIGN (32)
+
+#define HOST_IF_DMA_ALIGNED(p) \
+  (((uintptr_t)(p) & (HOST_IF_DMA_ALIGN - 1)) == 0)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+FAR void *host_if_dma_alloc(size_t size);
+void host_if_dma_free(FAR void *buf);
+void host_if_dma_print(void);
+
+#endif /* __APPS_EXAMPLES_GHIFP_HOST_IF_DMA_H */
@@ -9,32 +9,124 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
 
+#include <nuttx/arch.h>
 #include <nuttx/board.h>
 #include <arch/board/board.h>
+#include <arch/chip/pin.h>
 #include <../../nuttx/arch/arm/src/cxd56xx/cxd56_i2c.h>
 
 #include "host_if.h"
 #include "host_if_bs.h"
+#include "host_if_bus.h"
+#include "host_if_i2c.h"
 #include "gacrux_protocol_def.h"
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define BUS_REQ_ENABLE
+/* Without the bus request line, Gacrux is polled for frames. */
+
+#ifndef CONFIG_EXAMPLES_GHIFP_I2C_POLLING
+#  define BUS_REQ_ENABLE
+#endif
+
+#ifdef CONFIG_EXAMPLES_GHIFP_I2C_POLL_MIN_US
+#  define I2C_POLL_MIN_US CONFIG_EXAMPLES_GHIFP_I2C_POLL_MIN_US
+#else
+#  define I2C_POLL_MIN_US (1000)
+#endif
+#ifdef CONFIG_EXAMPLES_GHIFP_I2C_POLL_MAX_US
+#  define I2C_POLL_MAX_US CONFIG_EXAMPLES_GHIFP_I2C_POLL_MAX_US
+#else
+#  define I2C_POLL_MAX_US (100000)
+#endif
+#define I2C_POLL_FAST_NUM (100) /* Polls by I2C_POLL_MIN_US after a command */
 
 #define I2C0_BUS          (0)
 
+#define HOST_IF_CH        (HOST_IF_BS_CH_I2C)
+
 #define I2C_DEFAULT_SPEED (400000) /* 400K */
 
+/* Host clock of each bus mode. Gacrux in a faster mode still takes the
+ * slower clocks, so the fastest one the board allows is used.
+ */
+
+#define I2C_FREQ_STANDARD (100000)
+#ifdef CONFIG_EXAMPLES_GHIFP_I2C_FMPLUS
+#  define I2C_FREQ_FMPLUS (1000000)
+#else
+#  define I2C_FREQ_FMPLUS (400000)
+#endif
+#ifdef CONFIG_EXAMPLES_GHIFP_I2C_HSMODE
+#  define I2C_FREQ_HS     (3400000) /* Master code is sent by the driver */
+#else
+#  define I2C_FREQ_HS     I2C_FREQ_FMPLUS
+#endif
+
 #define I2C_DEFAULT_TARGET_ADDRESS     (0x24)
 #define I2C_DEFAULT_TARGET_ADDRESS_LEN (7)
 
+/* Gacrux sends a frame in chunks and requests the bus for each one.
+ * The size is changed by CHUNKCONF.
+ */
+
+#define I2C_RX_CHUNK_DEFAULT (512)
+
+/* Bytes read with the header when no response is expected, e.g. events.
+ * A longer frame is completed by a follow-up read.
+ */
+
+#ifdef CONFIG_EXAMPLES_GHIFP_I2C_RX_SPEC_LEN
+#  define I2C_RX_SPEC_LEN CONFIG_EXAMPLES_GHIFP_I2C_RX_SPEC_LEN
+#else
+#  define I2C_RX_SPEC_LEN (FRAMECHKERR_SIZE)
+#endif
+
+/* A failed read is retried with a doubling delay, and the last retry
+ * follows a bus clear. Then the frame is given up.
+ */
+
+#define I2C_RX_RETRY_MAX      (5)
+#define I2C_RX_RETRY_DELAY_US (100)
+
+#define I2C_BUS_CLEAR_CLOCKS  (9)
+#define I2C_BUS_CLEAR_HALF_US (5) /* 100kHz */
+
+/* I2C0 is shared with other clients through g_i2c_bus. A chunk of a
+ * received frame must be read before Gacrux gives it up.
+ */
+
+#define I2C_RX_DEADLINE_US    (10000)
+
+#define LOCK(prio, deadline_us) host_if_bus_acquire(&g_i2c_bus, prio, \
+                                                    deadline_us)
+#define UNLOCK()                host_if_bus_release(&g_i2c_bus)
+
  /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+/* Error counters by class, see i2c_err_count(). */
+
+struct i2c_err_stat_s
+{
+  uint32_t nack;      /* No acknowledge from Gacrux */
+  uint32_t timeout;
+  uint32_t busy;      /* Arbitration lost or bus busy */
+  uint32_t other;
+  uint32_t recovered; /* Reads which passed by a retry */
+  uint32_t given_up;  /* Frames given up after all retries */
+  uint32_t bus_clear;
+  uint32_t hdr_err;
+  uint32_t data_err;
+};
+
 static int i2c_recv_task(int argc, FAR char *argv[]);
 static int change_speed(uint8_t speed_number);
 static FAR struct i2c_master_s *i2c_dev_init(void);
@@ -68,15 +160,376 @@ struct host_if_s g_i2c = {
 static struct i2c_master_s *g_dev = NULL;
 static FAR uint8_t         *g_i2c_local_buf = NULL;
 static uint32_t            g_i2c_freq = I2C_DEFAULT_SPEED;
+static uint8_t             g_i2c_speed_no = SPEED_I2C_1000000BPS;
 static pid_t               g_i2c_task_pid = 0;
 static hostif_evt_cb       g_evt_cb = NULL;
 static uint16_t            g_targetaddr = I2C_DEFAULT_TARGET_ADDRESS;
 static int                 g_i2c_dbg_recv = 0;
+static volatile uint32_t   g_i2c_rx_spec_len = I2C_RX_SPEC_LEN;
+static volatile uint32_t   g_i2c_rx_chunk = I2C_RX_CHUNK_DEFAULT;
+static struct host_if_rx_stat_s g_i2c_rx_stat;
+static struct i2c_err_stat_s g_i2c_err;
+static struct host_if_bus_s g_i2c_bus; /* Owner of g_dev transfers */
+static bool                g_i2c_bus_valid = false;
+#ifndef BUS_REQ_ENABLE
+static sem_t               g_i2c_poll_sem;
+static uint32_t            g_i2c_poll_us = I2C_POLL_MIN_US;
+static volatile int        g_i2c_poll_fast = 0;
+#endif
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/* Response frame size of a command, read at once with its header. */
+
+static uint32_t i2c_res_size(uint8_t opc)
+{
+  switch (opc)
+    {
+      case CHGSTAT_OPC:
+        return CHGSTAT_RES_SIZE;
+      case CHUNKCONF_OPC:
+        return CHUNKCONF_RES_SIZE;
+      case TXFW_OPC:
+      case TX_BIN_OPC:
+        return TXFW_RES_SIZE;
+      case EXECFW_OPC:
+        return EXECFW_RES_SIZE;
+      case UARTCONF_OPC:
+        return UARTCONF_RES_SIZE;
+      case I2CCONF_OPC:
+        return I2CCONF_RES_SIZE;
+      case SPICONF_OPC:
+        return SPICONF_RES_SIZE;
+      case COMPCONF_OPC:
+        return COMPCONF_RES_SIZE;
+      default:
+        break;
+    }
+
+  return I2C_RX_SPEC_LEN;
+}
+
+static void i2c_err_count(int err)
+{
+  switch (err)
+    {
+      case -ENXIO:
+      case -ENODEV:
+        g_i2c_err.nack++;
+        break;
+      case -ETIMEDOUT:
+        g_i2c_err.timeout++;
+        break;
+      case -EAGAIN:
+      case -EBUSY:
+        g_i2c_err.busy++;
+        break;
+      default:
+        g_i2c_err.other++;
+        break;
+    }
+}
+
+static void i2c_err_print(void)
+{
+  printf("I2C error nack:%lu timeout:%lu busy:%lu other:%lu\n",
+         g_i2c_err.nack, g_i2c_err.timeout, g_i2c_err.busy,
+         g_i2c_err.other);
+  printf("  recovered:%lu given up:%lu bus clear:%lu "
+         "header:%lu data:%lu\n",
+         g_i2c_err.recovered, g_i2c_err.given_up, g_i2c_err.bus_clear,
+         g_i2c_err.hdr_err, g_i2c_err.data_err);
+}
+
+/* Release a target holding SDA low, e.g. after a transfer was cut in the
+ * middle of a byte. SCL is clocked by GPIO until SDA is high, then STOP
+ * is made and the controller is initialized again.
+ */
+
+static void i2c_bus_clear(void)
+{
+  int i;
+
+  LOCK(HOST_IF_BUS_PRIO_HIGH, HOST_IF_BUS_NO_DEADLINE);
+
+  printf("I2C bus clear.\n");
+  g_i2c_err.bus_clear++;
+
+  if (g_dev)
+    {
+      i2c_dev_uninit(g_dev);
+      g_dev = NULL;
+    }
+
+  /* Open drain by GPIO: write 0 drives low, -1 releases to the pull-up. */
+
+  board_gpio_config(PIN_I2C0_BCK, 0, true, false, PIN_PULLUP);
+  board_gpio_config(PIN_I2C0_BDT, 0, true, false, PIN_PULLUP);
+  board_gpio_write(PIN_I2C0_BDT, -1);
+  board_gpio_write(PIN_I2C0_BCK, -1);
+  up_udelay(I2C_BUS_CLEAR_HALF_US);
+
+  for (i=0; i<I2C_BUS_CLEAR_CLOCKS && !board_gpio_read(PIN_I2C0_BDT); i++)
+    {
+      board_gpio_write(PIN_I2C0_BCK, 0);
+      up_udelay(I2C_BUS_CLEAR_HALF_US);
+      board_gpio_write(PIN_I2C0_BCK, -1);
+      up_udelay(I2C_BUS_CLEAR_HALF_US);
+    }
+
+  /* STOP */
+
+  board_gpio_write(PIN_I2C0_BCK, 0);
+  board_gpio_write(PIN_I2C0_BDT, 0);
+  up_udelay(I2C_BUS_CLEAR_HALF_US);
+  board_gpio_write(PIN_I2C0_BCK, -1);
+  up_udelay(I2C_BUS_CLEAR_HALF_US);
+  board_gpio_write(PIN_I2C0_BDT, -1);
+  up_udelay(I2C_BUS_CLEAR_HALF_US);
+
+  if (!board_gpio_read(PIN_I2C0_BDT))
+    {
+      printf("SDA is still low after %d clocks.\n", i);
+    }
+
+  /* Pins go back to I2C with the controller reset. */
+
+  g_dev = i2c_dev_init();
+
+  UNLOCK();
+}
+
+/* One read holds the bus, so a long frame is split at the chunks. */
+
+static int i2c_bus_read(FAR struct i2c_config_s *config,
+                        FAR uint8_t *buf, uint32_t len,
+                        int prio, uint32_t deadline_us)
+{
+  int ret = -ENODEV;
+
+  LOCK(prio, deadline_us);
+
+  if (g_dev)
+    {
+      ret = i2c_read(g_dev, config, buf, len);
+    }
+
+  UNLOCK();
+
+  return ret;
+}
+
+static int i2c_read_retry(FAR struct i2c_config_s *config,
+                          FAR uint8_t *buf, uint32_t len)
+{
+  int      ret = -ENODEV;
+  int      retry;
+  uint32_t delay_us = I2C_RX_RETRY_DELAY_US;
+
+  for (retry=0; ; retry++)
+    {
+      ret = i2c_bus_read(config, buf, len, HOST_IF_BUS_PRIO_NORMAL,
+                         I2C_RX_DEADLINE_US);
+      if (ret == 0)
+        {
+          if (retry)
+            {
+              g_i2c_err.recovered++;
+            }
+
+          return 0;
+        }
+
+      i2c_err_count(ret);
+
+      if (I2C_RX_RETRY_MAX <= retry)
+        {
+          break;
+        }
+
+      HIF_DBG("Failed to read data:%d retry(%d/%d)\n",
+              ret, retry+1, I2C_RX_RETRY_MAX);
+
+      if (retry+1 == I2C_RX_RETRY_MAX)
+        {
+          i2c_bus_clear();
+        }
+      else
+        {
+          usleep(delay_us);
+          delay_us *= 2;
+        }
+    }
+
+  printf("Failed to read data:%d\n", ret);
+  g_i2c_err.given_up++;
+  i2c_err_print();
+
+  return ret;
+}
+
+/* Read the rest of a frame of frame_len bytes, len bytes of it are
+ * already in buf.
+ */
+
+static int i2c_read_rest(FAR struct i2c_config_s *config,
+                         FAR uint8_t *buf, uint32_t len, uint32_t frame_len)
+{
+  int      ret;
+  uint32_t n;
+  uint32_t chunk = g_i2c_rx_chunk;
+
+  while (len < frame_len)
+    {
+#ifdef BUS_REQ_ENABLE
+      if ((len % chunk) == 0)
+        {
+          ret = bus_req_wait_i2c();
+          if (ret != 0)
+            {
+              printf("Failed to wait bus req:%d\n", ret);
+              return ret;
+            }
+
+          g_i2c_rx_stat.bus_reqs++;
+        }
+#endif
+
+      n = chunk - (len % chunk);
+      if (frame_len - len < n)
+        {
+          n = frame_len - len;
+        }
+
+      ret = i2c_read_retry(config, &buf[len], n);
+      if (ret != 0)
+        {
+          return ret;
+        }
+
+      len += n;
+    }
+
+  return 0;
+}
+
+#ifndef BUS_REQ_ENABLE
+/* A command was sent, poll by the shortest interval for its response. */
+
+static void i2c_poll_kick(void)
+{
+  g_i2c_poll_fast = I2C_POLL_FAST_NUM;
+  sem_post(&g_i2c_poll_sem);
+}
+
+/* Sleep the poll interval, a sent command ends it at once. */
+
+static void i2c_poll_wait(uint32_t us)
+{
+  struct timespec abs_time;
+
+  clock_gettime(CLOCK_REALTIME, &abs_time);
+  abs_time.tv_sec  += us / 1000000;
+  abs_time.tv_nsec += (us % 1000000) * 1000;
+  if (1000000000 <= abs_time.tv_nsec)
+    {
+      abs_time.tv_sec++;
+      abs_time.tv_nsec -= 1000000000;
+    }
+
+  sem_timedwait(&g_i2c_poll_sem, &abs_time);
+}
+
+/* Poll Gacrux for a frame by its first byte. The interval is short after
+ * a command, doubles while idle, and is skipped after a frame since more
+ * often follow. Then the header and spec_len bytes in all are read.
+ */
+
+static int i2c_poll_header(FAR struct i2c_config_s *config,
+                           uint32_t spec_len)
+{
+  int ret;
+
+  if (g_i2c_poll_us)
+    {
+      i2c_poll_wait(g_i2c_poll_us);
+    }
+
+  ret = i2c_bus_read(config, g_i2c_local_buf, 1, HOST_IF_BUS_PRIO_LOW,
+                     HOST_IF_BUS_NO_DEADLINE);
+  if (ret != 0 || g_i2c_local_buf[0] != GHIFP_SYNC)
+    {
+      if (0 < g_i2c_poll_fast)
+        {
+          g_i2c_poll_fast--;
+          g_i2c_poll_us = I2C_POLL_MIN_US;
+        }
+      else if (g_i2c_poll_us < I2C_POLL_MIN_US)
+        {
+          g_i2c_poll_us = I2C_POLL_MIN_US;
+        }
+      else if (g_i2c_poll_us < I2C_POLL_MAX_US)
+        {
+          g_i2c_poll_us *= 2;
+          if (I2C_POLL_MAX_US < g_i2c_poll_us)
+            {
+              g_i2c_poll_us = I2C_POLL_MAX_US;
+            }
+        }
+
+      return -EAGAIN;
+    }
+
+  g_i2c_poll_us = 0;
+
+  return i2c_read_retry(config, g_i2c_local_buf + 1, spec_len - 1);
+}
+#endif
+
+/* Writers hold the bus for one frame. */
+
+static int i2c_write_frame(FAR struct i2c_config_s *config,
+                           FAR uint8_t *data, uint32_t sz)
+{
+  int ret = -ENODEV;
+
+  LOCK(HOST_IF_BUS_PRIO_NORMAL, HOST_IF_BUS_NO_DEADLINE);
+
+  if (g_dev)
+    {
+      ret = i2c_write(g_dev, config, (FAR const uint8_t *)data, sz);
+    }
+
+  UNLOCK();
+
+  if (ret != 0)
+    {
+      i2c_err_count(ret);
+    }
+#ifndef BUS_REQ_ENABLE
+  else
+    {
+      i2c_poll_kick();
+    }
+#endif
+
+  return ret;
+}
+
+/* A frame was given up, so fail the waiting transaction now. */
+
+static void i2c_recv_fail(int err)
+{
+  g_i2c_rx_spec_len = I2C_RX_SPEC_LEN;
+
+  if (get_host_if_state(HOST_IF_CH) == HOST_IF_STATE_WAIT_RESPONSE)
+    {
+      push_dataframe_error(HOST_IF_CH, err);
+    }
+}
+
 static int i2c_recv_task(int argc, FAR char *argv[])
 {
   int                 ret;
@@ -84,6 +537,8 @@ static int i2c_recv_task(int argc, FAR char *argv[])
   struct i2c_config_s config;
   uint8_t             opc;
   uint16_t            opr_len = 0;
+  uint32_t            spec_len = GHIFP_HEADER_SIZE;
+  struct timespec     start;
 
   memset(g_i2c_local_buf, 0, LOCAL_BUFF_SZ);
 
@@ -105,6 +560,9 @@ static int i2c_recv_task(int argc, FAR char *argv[])
           continue;
         }
 
+      clock_gettime(CLOCK_REALTIME, &start);
+      g_i2c_rx_stat.bus_reqs++;
+
       // printf("Detect Bus Request.(1)\n");
 
       opr_len = 0;
@@ -116,9 +574,9 @@ static int i2c_recv_task(int argc, FAR char *argv[])
       if (g_i2c_dbg_recv != 0)
         {
           /* Read header. */
-          ret = i2c_read(g_dev, &config,
-                        g_i2c_local_buf,
-                        256);
+          ret = i2c_bus_read(&config, g_i2c_local_buf, 256,
+                             HOST_IF_BUS_PRIO_NORMAL,
+                             HOST_IF_BUS_NO_DEADLINE);
           printf("Data dump.\n");
           for (i=0; i<256; i++)
             {
@@ -129,161 +587,105 @@ static int i2c_recv_task(int argc, FAR char *argv[])
         }
       else
         {
-          /* Read header. */
-          ret = i2c_read(g_dev, &config,
-                        g_i2c_local_buf,
-                        GHIFP_HEADER_SIZE);
-          while (ret != 0)
+          /* Read the header and the expected payload in one
+           * transaction, it saves the start/address/stop overhead of a
+           * second read for most responses.
+           */
+
+          spec_len = g_i2c_rx_spec_len;
+          if (spec_len < GHIFP_HEADER_SIZE)
             {
-              printf("Failed to read header1:%d ", ret);
-              ret = i2c_read(g_dev, &config,
-                        g_i2c_local_buf,
-                        GHIFP_HEADER_SIZE);
-              // continue;
+              spec_len = GHIFP_HEADER_SIZE;
+            }
+          else if (g_i2c_rx_chunk < spec_len)
+            {
+              spec_len = g_i2c_rx_chunk;
             }
-          // printf("header: %x %x %x %x % x\n", g_i2c_local_buf[0], g_i2c_local_buf[1], g_i2c_local_buf[2], g_i2c_local_buf[3], g_i2c_local_buf[4]);
 
-          ret = check_header(g_i2c_local_buf, &opc, &opr_len);
+          ret = i2c_read_retry(&config, g_i2c_local_buf, spec_len);
           if (ret != 0)
-          {
-            printf("Invalid header.(I2C)\n");
-            continue;
-          }
-          else {
-            // printf("Header dump.(I2C)\n");
-            for (i=0; i<GHIFP_HEADER_SIZE; i++)
             {
-              // printf("%02X ", g_i2c_local_buf[i]);
-              printf("%d   ", opc);
-              break;
+              i2c_recv_fail(ret);
+              continue;
             }
-            // printf("\n");
-          }
         }
 #else /* Polling */
-      printf("Polling\n");
-      /* Read first a byte. */
-      ret = i2c_read(g_dev, &config,
-                     g_i2c_local_buf,
-                     1);
-      if (ret != 0)
+      config.frequency = g_i2c_freq;
+      config.address   = g_targetaddr;
+      config.addrlen   = I2C_DEFAULT_TARGET_ADDRESS_LEN;
+
+      spec_len = g_i2c_rx_spec_len;
+      if (spec_len < GHIFP_HEADER_SIZE)
         {
-          printf("Failed to read first a byte:%d\n", ret);
-          sleep(2);
-          continue;
+          spec_len = GHIFP_HEADER_SIZE;
+        }
+      else if (g_i2c_rx_chunk < spec_len)
+        {
+          spec_len = g_i2c_rx_chunk;
         }
 
-      if (g_i2c_local_buf[0] != GHIFP_SYNC)
+      ret = i2c_poll_header(&config, spec_len);
+      if (ret == -EAGAIN)
         {
-          sleep(1);
           continue;
         }
-
-      /* Read header. */
-      ret = i2c_read(g_dev, &config,
-                     g_i2c_local_buf + 1,
-                     GHIFP_HEADER_SIZE - 1);
-      if (ret != 0)
+      else if (ret != 0)
         {
-          printf("Failed to read header:%d\n", ret);
+          i2c_recv_fail(ret);
           continue;
         }
+
+      clock_gettime(CLOCK_REALTIME, &start);
 #endif
 
       /* Check header */
       ret = check_header(g_i2c_local_buf, &opc, &opr_len);
       if (ret != 0)
         {
-          printf("Invalid header.(I2C)\n\n");
+          printf("Invalid header.(I2C)\n");
+          g_i2c_err.hdr_err++;
           continue;
         }
 
-      /* Read data. */
-#ifdef BUS_REQ_ENABLE
+      HIF_DBG("%d   ", opc);
 
-      int rec_size = GHIFP_DATA_SIZE(opr_len) + GHIFP_HEADER_SIZE;
-      int num = rec_size / 512 + ((rec_size % 512) ? 0 : -1);
-      // printf("rec_size: %d, packet: %d\n", rec_size, num);
-
-      int first = 1;
-      int finished_size = GHIFP_HEADER_SIZE;
-      while (num--)
-      {
-        if (first) {
-          ret = i2c_read(g_dev, &config,
-                     g_i2c_local_buf + finished_size,
-                     512 - GHIFP_HEADER_SIZE);
-          while (ret != 0)
-            {
-              printf("Failed to read data0:%d\n", ret);
-              ret = i2c_read(g_dev, &config,
-                      g_i2c_local_buf + finished_size,
-                      512 - GHIFP_HEADER_SIZE);
-            }
-            first = 0;
-            finished_size += 512 - GHIFP_HEADER_SIZE;
-        }
-        else
+      /* Read data. Without the bus request, Gacrux holds SCL low until
+       * the next chunk is ready.
+       */
+
+      if (LOCAL_BUFF_SZ < GHIFP_FRAME_SIZE(opr_len))
         {
-          ret = i2c_read(g_dev, &config,
-                     g_i2c_local_buf + finished_size,
-                     512);
-          while (ret != 0)
-            {
-              printf("Failed to read data0:%d\n", ret);
-              ret = i2c_read(g_dev, &config,
-                      g_i2c_local_buf + finished_size,
-                      512);
-              // continue;
-            }
-            finished_size += 512;
+          printf("Too long frame.(I2C: %d)\n", opr_len);
+          continue;
         }
 
-        ret = bus_req_wait_i2c();
-        if (ret != 0)
-          {
-            printf("Failed to wait bus req:%d\n", ret);
-            continue;
-          }
-        // printf("Detect Bus Request.(2)\n");
-      }
-
-      int read_size = rec_size % 512;
-      if (first) {
-        read_size = (rec_size - GHIFP_HEADER_SIZE) % 512;
-      }
-
-       if (read_size) {
-        //  ret = i2c_read(g_dev, &config,
-        //                 g_i2c_local_buf + GHIFP_HEADER_SIZE + 512 * (int)(rec_size / 513),
-        //                 read_size);
-        ret = i2c_read(g_dev, &config,
-              g_i2c_local_buf + finished_size, read_size);
-         while (ret != 0)
-         {
-           printf("Failed to read data:%d\n", ret);
-           ret = i2c_read(g_dev, &config,
-                          g_i2c_local_buf + finished_size, read_size);
-           // continue;
-          }
-       }
+      ret = i2c_read_rest(&config, g_i2c_local_buf, spec_len,
+                          GHIFP_FRAME_SIZE(opr_len));
+      if (ret != 0)
+        {
+          i2c_recv_fail(ret);
+          continue;
+        }
 
       // printf("Data dump.(I2C)\n");
       for (i=0; i<GHIFP_DATA_SIZE(opr_len); i++)
         {
           // printf("%02X(%d) ", g_i2c_local_buf[GHIFP_HEADER_SIZE + i], i);
-          printf("%d ", g_i2c_local_buf[GHIFP_HEADER_SIZE + i]);
+          HIF_DBG("%d ", g_i2c_local_buf[GHIFP_HEADER_SIZE + i]);
         }
-      printf("\n");
+      HIF_DBG("\n");
 
       /* Check data */
       ret = check_data(g_i2c_local_buf + GHIFP_HEADER_SIZE, opr_len);
       if (ret != 0)
         {
           printf("Invalid data.(I2C: %d)\n", opr_len);
+          g_i2c_err.data_err++;
           continue;
         }
 
+      rx_stat_frame(&g_i2c_rx_stat, GHIFP_FRAME_SIZE(opr_len), &start);
+
       // int input = 0;
       // if (opc == 48)
       // {
@@ -303,7 +705,6 @@ static int i2c_recv_task(int argc, FAR char *argv[])
       //   fclose(fp);
       // }
       // printf("finished.(I2C)\n");
-#endif
       if (true == is_evt_data(opc))
         {
           /* OPC type -> Event, notify by callback. */
@@ -316,9 +717,11 @@ static int i2c_recv_task(int argc, FAR char *argv[])
       else
         {
           /* OPC type -> Normal response, push to queue. */
-          if (get_host_if_state() == HOST_IF_STATE_WAIT_RESPONSE)
+          g_i2c_rx_spec_len = I2C_RX_SPEC_LEN;
+
+          if (get_host_if_state(HOST_IF_CH) == HOST_IF_STATE_WAIT_RESPONSE)
             {
-              ret = push_dataframe(g_i2c_local_buf,
+              ret = push_dataframe(HOST_IF_CH, g_i2c_local_buf,
                                    GHIFP_FRAME_SIZE(opr_len));
               if (ret != 0)
                 {
@@ -349,10 +752,13 @@ static int conv_i2c_speed_number(uint8_t speed_no)
   switch (speed_no)
     {
       case SPEED_I2C_100000BPS:
-        return 100000;
+        return I2C_FREQ_STANDARD;
+        break;
+      case SPEED_I2C_1000000BPS:
+        return I2C_FREQ_FMPLUS;
         break;
-      case SPEED_I2C_400000BPS:
-        return 400000;
+      case SPEED_I2C_3400000BPS:
+        return I2C_FREQ_HS;
         break;
       default:
         break;
@@ -373,7 +779,8 @@ static int change_speed(uint8_t speed_number)
   else
     {
       printf("Change speed. %lu -> %lu\n", g_i2c_freq, (uint32_t)ret);
-      g_i2c_freq = (uint32_t)ret;
+      g_i2c_freq     = (uint32_t)ret;
+      g_i2c_speed_no = speed_number;
     }
 
   /* No need to re-create task.
@@ -425,7 +832,7 @@ static int host_if_i2c_write(
   uint8_t             opc;
   uint16_t            opr_len;
 
-  printf("host_if_i2c_write() len=%ld\n", sz);
+  HIF_DBG("host_if_i2c_write() len=%ld\n", sz);
 
   if (!thiz || !data || !sz)
     {
@@ -447,23 +854,26 @@ static int host_if_i2c_write(
       return ret;
     }
 
-  printf("I2C frequency:%lu\n", g_i2c_freq);
+  HIF_DBG("I2C frequency:%lu\n", g_i2c_freq);
 
   config.frequency = g_i2c_freq;
   config.address   = g_targetaddr;
   config.addrlen   = I2C_DEFAULT_TARGET_ADDRESS_LEN;
 
-  ret = i2c_write(g_dev, &config,
-                  (FAR const uint8_t *)data,
-                  sz);
+  g_i2c_rx_spec_len = i2c_res_size(opc);
+
+  /* Wait for the response before it can arrive. */
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+
+  ret = i2c_write_frame(&config, data, sz);
   if (ret != 0)
     {
       printf("Failed to send dataframe:%d\n", ret);
+      set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
       goto exit;
     }
 
-  set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
-
 exit:
   return ret;
 }
@@ -474,15 +884,15 @@ static int host_if_i2c_read(
   int      ret = -EINVAL;
   uint32_t res_len;
 
-  printf("host_if_i2c_read() buflen=%ld\n", sz);
+  HIF_DBG("host_if_i2c_read() buflen=%ld\n", sz);
 
   if (!thiz || !buf || !sz)
     {
       return ret;
     }
 
-  ret = pop_dataframe(buf, sz, &res_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, sz, &res_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
@@ -490,7 +900,7 @@ static int host_if_i2c_read(
     }
   else
     {
-      printf("Response dataframe len:%ld\n", res_len);
+      HIF_DBG("Response dataframe len:%ld\n", res_len);
       return res_len;
     }
 }
@@ -507,7 +917,7 @@ static int host_if_i2c_transaction(
   uint8_t             opc;
   uint16_t            opr_len;
 
-  printf("I2C transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
+  HIF_DBG("I2C transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
 
   if (!thiz || !data || !w_sz || !buf || !r_sz || !res_len)
     {
@@ -529,24 +939,28 @@ static int host_if_i2c_transaction(
       return ret;
     }
 
-  printf("I2C frequency:%lu\n", g_i2c_freq);
+  HIF_DBG("I2C frequency:%lu\n", g_i2c_freq);
 
   config.frequency = g_i2c_freq;
   config.address   = g_targetaddr;
   config.addrlen   = I2C_DEFAULT_TARGET_ADDRESS_LEN;
 
-  ret = i2c_write(g_dev, &config,
-                  (FAR const uint8_t *)data,
-                  w_sz);
+  g_i2c_rx_spec_len = i2c_res_size(opc);
+
+  /* Wait for the response before it can arrive. */
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+
+  ret = i2c_write_frame(&config, data, w_sz);
   if (ret != 0)
     {
       printf("Failed to send dataframe:%d\n", ret);
+      set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
       goto exit;
     }
-  set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
 
-  ret = pop_dataframe(buf, r_sz, &df_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, r_sz, &df_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
@@ -554,7 +968,7 @@ static int host_if_i2c_transaction(
     }
   else
     {
-      printf("Response dataframe len:%ld\n", df_len);
+      HIF_DBG("Response dataframe len:%ld\n", df_len);
       *res_len = df_len;
     }
 
@@ -569,7 +983,7 @@ static int host_if_i2c_dbg_write(
   int                 ret = -EINVAL;
   struct i2c_config_s config;
 
-  printf("host_if_i2c_dbg_write() len=%ld\n", sz);
+  HIF_DBG("host_if_i2c_dbg_write() len=%ld\n", sz);
 
   if (!thiz || !data || !sz)
     {
@@ -581,15 +995,13 @@ static int host_if_i2c_dbg_write(
       return -EPERM;
     }
 
-  printf("I2C frequency:%lu\n", g_i2c_freq);
+  HIF_DBG("I2C frequency:%lu\n", g_i2c_freq);
 
   config.frequency = g_i2c_freq;
   config.address   = g_targetaddr;
   config.addrlen   = I2C_DEFAULT_TARGET_ADDRESS_LEN;
 
-  ret = i2c_write(g_dev, &config,
-                  (FAR const uint8_t *)data,
-                  sz);
+  ret = i2c_write_frame(&config, data, sz);
   if (ret != 0)
     {
       printf("I2C write error:%d\n", ret);
@@ -619,8 +1031,8 @@ static int host_if_i2c_set_config(
         g_i2c_dbg_recv = atoi((char *)arg);
         printf("Debug receive mode:%s\n",
                g_i2c_dbg_recv ? "ON" : "OFF");
-        ret = restart_task(g_i2c_task_pid, "ghifp_i2c_task",
-                           i2c_recv_task, NULL);
+        host_if_bus_stop_task(&g_i2c_bus, g_i2c_task_pid);
+        ret = start_task("ghifp_i2c_task", i2c_recv_task, NULL);
         if (0 < ret)
           {
             g_i2c_task_pid = ret;
@@ -629,6 +1041,27 @@ static int host_if_i2c_set_config(
       case HOST_IF_SET_CONFIG_REQ_SETSLVCONF:
         ret = change_speed(*(uint8_t *)arg);
         break;
+      case HOST_IF_SET_CONFIG_REQ_GETSLVCONF:
+        *(uint8_t *)arg = g_i2c_speed_no;
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_PRINTSTAT:
+        rx_stat_print(&g_i2c_rx_stat, g_i2c_rx_chunk);
+        host_if_bus_print(&g_i2c_bus, *(uint8_t *)arg);
+        i2c_err_print();
+        if (*(uint8_t *)arg)
+          {
+            memset(&g_i2c_rx_stat, 0, sizeof(g_i2c_rx_stat));
+            memset(&g_i2c_err, 0, sizeof(g_i2c_err));
+          }
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_SETCHUNK:
+        printf("Change chunk size. %lu -> %u\n",
+               g_i2c_rx_chunk, *(uint16_t *)arg);
+        g_i2c_rx_chunk = *(uint16_t *)arg;
+        ret = 0;
+        break;
       default:
         printf("Nothing to do in I2C mode.\n");
         break;
@@ -640,6 +1073,38 @@ static int host_if_i2c_set_config(
  * Public Functions
  ****************************************************************************/
 
+/* Transfer on I2C0 for other devices on the bus, e.g. sensors. It is
+ * scheduled against Gacrux frames by prio and deadline_us, see
+ * host_if_bus.h.
+ */
+
+int host_if_i2c_bus_transfer(FAR struct i2c_msg_s *msgs, int count,
+                             int prio, uint32_t deadline_us)
+{
+  int ret = -ENODEV;
+
+  if (!msgs || count <= 0)
+    {
+      return -EINVAL;
+    }
+
+  if (!g_i2c_bus_valid)
+    {
+      return -ENODEV;
+    }
+
+  LOCK(prio, deadline_us);
+
+  if (g_dev)
+    {
+      ret = I2C_TRANSFER(g_dev, msgs, count);
+    }
+
+  UNLOCK();
+
+  return ret;
+}
+
 FAR struct host_if_s *host_if_i2c_create(hostif_evt_cb evt_cb)
 {
   if (!evt_cb)
@@ -651,12 +1116,27 @@ FAR struct host_if_s *host_if_i2c_create(hostif_evt_cb evt_cb)
       g_evt_cb = evt_cb;
     }
 
+  if (host_if_bus_init(&g_i2c_bus) < 0)
+    {
+      goto errout;
+    }
+  g_i2c_bus_valid = true;
+
   g_dev = i2c_dev_init();
   if (!g_dev)
     {
       goto errout;
     }
 
+#ifndef BUS_REQ_ENABLE
+  sem_init(&g_i2c_poll_sem, 0, 0);
+  g_i2c_poll_us = I2C_POLL_MIN_US;
+#endif
+
+  memset(&g_i2c_err, 0, sizeof(g_i2c_err));
+  memset(&g_i2c_rx_stat, 0, sizeof(g_i2c_rx_stat));
+  g_i2c_rx_chunk = I2C_RX_CHUNK_DEFAULT;
+
   g_i2c_local_buf = (FAR uint8_t *)malloc(LOCAL_BUFF_SZ);
   if (!g_i2c_local_buf)
     {
@@ -685,6 +1165,12 @@ errout:
       g_dev = NULL;
     }
 
+  if (g_i2c_bus_valid)
+    {
+      g_i2c_bus_valid = false;
+      host_if_bus_fin(&g_i2c_bus);
+    }
+
   g_evt_cb = NULL;
 
   return NULL;
@@ -692,9 +1178,13 @@ errout:
 
 int host_if_i2c_delete(FAR struct host_if_s *this)
 {
-  stop_task(g_i2c_task_pid);
+  host_if_bus_stop_task(&g_i2c_bus, g_i2c_task_pid);
   g_i2c_task_pid = 0;
 
+#ifndef BUS_REQ_ENABLE
+  sem_destroy(&g_i2c_poll_sem);
+#endif
+
   if (g_i2c_local_buf)
     {
       free(g_i2c_local_buf);
@@ -707,6 +1197,12 @@ int host_if_i2c_delete(FAR struct host_if_s *this)
       g_dev = NULL;
     }
 
+  if (g_i2c_bus_valid)
+    {
+      g_i2c_bus_valid = false;
+      host_if_bus_fin(&g_i2c_bus);
+    }
+
   g_evt_cb = NULL;
 
   return 0;
@@ -5,7 +5,11 @@
  * Included Files
  ****************************************************************************/
 
+#include <stdint.h>
+#include <nuttx/i2c/i2c_master.h>
+
 #include "host_if.h"
+#include "host_if_bus.h"
 
 /****************************************************************************
  * Public Types
@@ -17,5 +21,7 @@
 
 FAR struct host_if_s *host_if_i2c_create(hostif_evt_cb evt_cb);
 int host_if_i2c_delete(FAR struct host_if_s *this);
+int host_if_i2c_bus_transfer(FAR struct i2c_msg_s *msgs, int count,
+                             int prio, uint32_t deadline_us);
 
 #endif /* __APPS_EXAMPLES_GHIFP_HOST_IF_I2C_H */
@@ -13,37 +13,188 @@
 #include <errno.h>
 #include <time.h>
 #include <semaphore.h>
+#include <unistd.h>
 
 #include <nuttx/board.h>
 #include <arch/board/board.h>
 #include <nuttx/spi/spi.h>
 #include <../../nuttx/arch/arm/src/cxd56xx/cxd56_spi.h>
 #include <../../nuttx/arch/arm/src/cxd56xx/cxd56_pinconfig.h>
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_DMA
+#  include <../../nuttx/arch/arm/src/cxd56xx/cxd56_dmac.h>
+#endif
 
 #include "host_if.h"
 #include "host_if_bs.h"
+#include "host_if_bus.h"
+#include "host_if_dma.h"
 #include "gacrux_protocol_def.h"
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define LOCK()   pthread_mutex_lock(&g_mutex)
-#define UNLOCK() pthread_mutex_unlock(&g_mutex)
+/* A frame holds SPI4 from its first to its last byte. Received frames
+ * go first, a frame to send right after.
+ */
+
+#define LOCK(prio) host_if_bus_acquire(&g_spi_bus, prio, \
+                                       HOST_IF_BUS_NO_DEADLINE)
+#define UNLOCK()   host_if_bus_release(&g_spi_bus)
+
+#define SPI_BUS_PRIO_RX   (HOST_IF_BUS_PRIO_HIGH)
+#define SPI_BUS_PRIO_TX   (HOST_IF_BUS_PRIO_NORMAL)
+#define SPI_BUS_PRIO_POLL (HOST_IF_BUS_PRIO_LOW)
+
+/* Without the bus request line, Gacrux is polled for frames by one word
+ * exchanges.
+ */
+
+#ifndef CONFIG_EXAMPLES_GHIFP_SPI_POLLING
+#  define BUS_REQ_ENABLE
+#endif
+
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_POLL_MIN_US
+#  define SPI_POLL_MIN_US CONFIG_EXAMPLES_GHIFP_SPI_POLL_MIN_US
+#else
+#  define SPI_POLL_MIN_US (1000)
+#endif
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_POLL_MAX_US
+#  define SPI_POLL_MAX_US CONFIG_EXAMPLES_GHIFP_SPI_POLL_MAX_US
+#else
+#  define SPI_POLL_MAX_US (100000)
+#endif
+#define SPI_POLL_FAST_NUM (100) /* Polls by SPI_POLL_MIN_US after a command */
 
 #define SPI4_BUS          (4)
 
+#define HOST_IF_CH        (HOST_IF_BS_CH_SPI)
+
 #define SPI_DEFAULT_SPEED (2600000)
-#ifdef Bit16Test
-#define SPI_DEFAULT_DFS   (16)
+
+/* Gacrux sends a frame in chunks and requests the bus for each one.
+ * The size is changed by CHUNKCONF.
+ */
+
+#define SPI_RX_CHUNK_DEFAULT (1024)
+
+/* Data frame size, changed by SPICONF. Frames go in whole words, see
+ * spi_exchange().
+ */
+
+#define SPI_DEFAULT_DFS      (8)
+#define SPI_WORD_BYTES_MAX   (4)
+#define SPI_WORD_BYTES       ((uint32_t)g_spi_dfs / 8)
+#define SPI_WORD_LEN(sz)     (((sz) + SPI_WORD_BYTES - 1) / SPI_WORD_BYTES \
+                              * SPI_WORD_BYTES)
+
+/* The SPI4 controller takes words of 4 to 16 bits. A 32-bit frame is
+ * clocked as two 16-bit words, see spi_exchange32().
+ */
+
+#define SPI_HW_BITS          ((g_spi_dfs == 32) ? 16 : g_spi_dfs)
+#define SPI_HW_WORD_BYTES    ((uint32_t)SPI_HW_BITS / 8)
+#define SPI_SWAP_SZ          (512)
+
+/* Send a waiting frame during reads and keep what comes in during
+ * writes, when Gacrux takes both directions at once.
+ */
+
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_FULL_DUPLEX
+#  define SPI_FULL_DUPLEX
+#endif
+
+/* Shortest time from the end of a frame to the next one, unless a frame
+ * from Gacrux shows it is ready earlier.
+ */
+
+/* Control frames run at most at this clock No., bulk frames at the
+ * clock set by SETSPICLK or training. The clock is changed only when
+ * the class of a frame differs from the last one.
+ */
+
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_CTRL_CLK
+#  define SPI_CTRL_CLK_NO CONFIG_EXAMPLES_GHIFP_SPI_CTRL_CLK
 #else
-#define SPI_DEFAULT_DFS   (8)
+#  define SPI_CTRL_CLK_NO SPEED_SPI_2600000BPS
+#endif
+
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_FRAME_GAP_US
+#  define SPI_FRAME_GAP_US CONFIG_EXAMPLES_GHIFP_SPI_FRAME_GAP_US
+#else
+#  define SPI_FRAME_GAP_US (5000)
+#endif
+
+/* Transfers from SPI_DMA_THRESHOLD bytes go by DMA, in pieces of at most
+ * SPI_DMA_PIECE_MAX bytes. Without the SPI4 DMA channels or the DMA
+ * buffers everything goes by PIO.
+ */
+
+#if defined(CONFIG_EXAMPLES_GHIFP_SPI_DMA) && \
+    defined(CONFIG_CXD56_DMAC_SPI4_TX) && defined(CONFIG_CXD56_DMAC_SPI4_RX)
+#  define SPI_DMA
+#endif
+
+#ifdef CONFIG_EXAMPLES_GHIFP_SPI_DMA_THRESHOLD
+#  define SPI_DMA_THRESHOLD CONFIG_EXAMPLES_GHIFP_SPI_DMA_THRESHOLD
+#else
+#  define SPI_DMA_THRESHOLD (64)
+#endif
+#define SPI_DMA_PIECE_MAX    (4096)
+
+/* The driver decides by itself to use DMA for more words than
+ * CXD56_SPI_DMATHRESHOLD. PIO transfers of this file may come with a NULL
+ * buffer, which DMA cannot take, so they must stay below it.
+ */
+
+#ifdef SPI_DMA
+#  ifndef CONFIG_CXD56_SPI_DMATHRESHOLD
+#    error "EXAMPLES_GHIFP_SPI_DMA needs CXD56_SPI_DMATHRESHOLD"
+#  elif CONFIG_CXD56_SPI_DMATHRESHOLD < SPI_DMA_THRESHOLD
+#    error "CXD56_SPI_DMATHRESHOLD is below EXAMPLES_GHIFP_SPI_DMA_THRESHOLD"
+#  endif
 #endif
 
  /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef SPI_FULL_DUPLEX
+struct spi_duplex_s
+{
+  pthread_mutex_t   lock;      /* tx, tx_len and tx_pos */
+  FAR const uint8_t *tx;       /* Frame waiting for the bus */
+  uint32_t          tx_len;
+  uint32_t          tx_pos;    /* Bytes of tx already sent with reads */
+  FAR uint8_t       *tx_buf;   /* Piece of tx sent with a read */
+  FAR uint8_t       *rx;       /* Frame start received with a write */
+  uint32_t          rx_len;    /* Protected by LOCK() */
+
+  /* Statistics */
+
+  uint32_t          tx_shared; /* Bytes sent with reads */
+  uint32_t          rx_shared; /* Bytes received with writes */
+};
+#endif
+
+#ifdef SPI_DMA
+struct spi_dma_s
+{
+  DMA_HANDLE        tx;        /* Kept by the driver once configured */
+  DMA_HANDLE        rx;
+  bool              ok;        /* false: PIO only */
+  uint32_t          piece;     /* Bytes per DMA transfer */
+  FAR uint8_t       *zero;     /* Sent by reads */
+  FAR uint8_t       *tx_bounce; /* For unaligned buffers */
+  FAR uint8_t       *rx_bounce; /* Also takes what writes receive */
+
+  /* Statistics */
+
+  uint32_t          dma_bytes;
+  uint32_t          pio_bytes;
+};
+#endif
+
 static int spi_recv_task(int argc, FAR char *argv[]);
 static FAR struct spi_dev_s *spi_dev_init(void);
 static int spi_dev_uninit(void);
@@ -51,8 +202,22 @@ static int change_dfs(uint8_t dfs_number);
 static int change_dfs_old(int dfs);
 static int32_t conv_spi_clk_number(int clk_no);
 static int set_clock(int clock);
+static int spi_exchange(FAR const uint8_t *tx, FAR uint8_t *rx,
+                        uint32_t sz);
 static int spi_write(FAR uint8_t *data, uint32_t sz);
 static int spi_read(FAR uint8_t *buf, uint32_t sz, int test);
+static int spi_read_frame(FAR uint8_t *buf, uint32_t sz);
+static void spi_write_frame(FAR uint8_t *data, uint32_t sz);
+static void spi_ready_wait(void);
+static void spi_apply_class(void);
+#ifndef BUS_REQ_ENABLE
+static void spi_poll_kick(void);
+static int spi_poll_status(FAR uint32_t *pre);
+static int spi_poll_chunk(void);
+#endif
+static void spi_ready_reset(void);
+static int spi_read_rest(FAR uint8_t *buf, uint32_t len,
+                         uint32_t frame_len);
 static int spi_dummy_exchange(void);
 static int host_if_spi_write(
   FAR struct host_if_s *thiz, FAR uint8_t *data, uint32_t sz);
@@ -77,17 +242,40 @@ struct host_if_s g_spi = {
   .read = host_if_spi_read,
   .transaction = host_if_spi_transaction,
   .dbg_write = host_if_spi_dbg_write,
-  .set_config = host_if_spi_set_config
+  .set_config = host_if_spi_set_config,
+  .caps = HOST_IF_CAP_TRAFFIC_CLASS
 };
 
 static struct spi_dev_s *g_dev = NULL;
 static FAR uint8_t      *g_spi_local_buf = NULL;
 static uint32_t         g_spi_freq = SPI_DEFAULT_SPEED;
+static uint8_t          g_spi_clk_no = SPEED_SPI_2600000BPS;
+static uint32_t         g_spi_ctrl_freq = SPI_DEFAULT_SPEED;
+static uint32_t         g_spi_cur_freq = SPI_DEFAULT_SPEED; /* In g_dev */
+static volatile uint8_t g_spi_class = HOST_IF_CLASS_CONTROL;
+static uint32_t         g_spi_class_switches = 0;
 static int              g_spi_dfs = SPI_DEFAULT_DFS;
-static pthread_mutex_t  g_mutex;
+static struct host_if_bus_s g_spi_bus;
 static pid_t            g_spi_task_pid = 0;
 static hostif_evt_cb    g_evt_cb = NULL;
 static int              g_spi_dbg_recv = 0;
+static volatile uint32_t g_spi_rx_chunk = SPI_RX_CHUNK_DEFAULT;
+static struct host_if_rx_stat_s g_spi_rx_stat;
+static sem_t            g_spi_ready_sem; /* Posted by frames from Gacrux */
+static struct timespec  g_spi_tx_end;
+#ifndef BUS_REQ_ENABLE
+static sem_t            g_spi_poll_sem;
+static uint32_t         g_spi_poll_us = SPI_POLL_MIN_US;
+static volatile int     g_spi_poll_fast = 0;
+#endif
+#ifdef SPI_FULL_DUPLEX
+static struct spi_duplex_s g_spi_dup;
+#endif
+#ifdef SPI_DMA
+static struct spi_dma_s g_spi_dma;
+#endif
+static FAR uint8_t      *g_spi_swap_tx = NULL; /* For 32-bit frames */
+static FAR uint8_t      *g_spi_swap_rx = NULL;
 
 /****************************************************************************
  * Private Functions
@@ -101,6 +289,10 @@ static int spi_recv_task(int argc, FAR char *argv[])
   uint8_t     opc = 0;
   uint16_t    opr_len;
   int         finished_size = 0;
+  int         rec_size;
+  uint32_t    pre = 0; /* Header bytes read by polling */
+  struct timespec start;
+
   memset(g_spi_local_buf, 0, LOCAL_BUFF_SZ);
   printf("SPI frequency(recv):%lu\n", g_spi_freq);
 
@@ -111,13 +303,30 @@ static int spi_recv_task(int argc, FAR char *argv[])
 
   while (1)
     {
+#ifdef BUS_REQ_ENABLE
       ret = bus_req_wait_spi();
       if (ret != 0)
         {
           printf("Failed to wait bus req:%d\n", ret);
           continue;
         }
-      LOCK();
+
+      clock_gettime(CLOCK_REALTIME, &start);
+      g_spi_rx_stat.bus_reqs++;
+
+      LOCK(SPI_BUS_PRIO_RX);
+      spi_apply_class();
+#else
+      /* Returns with the bus held when a frame is there. */
+
+      ret = spi_poll_status(&pre);
+      if (ret != 0)
+        {
+          continue;
+        }
+
+      clock_gettime(CLOCK_REALTIME, &start);
+#endif
       // up_mdelay(1);
       opr_len = 0;
 
@@ -137,13 +346,31 @@ static int spi_recv_task(int argc, FAR char *argv[])
       else
         {
           /* Read header. */
-          read_len = spi_read(g_spi_local_buf, GHIFP_HEADER_SIZE, 0);
+#ifdef SPI_FULL_DUPLEX
+          if (g_spi_dup.rx_len)
+            {
+              /* The frame started during a write. */
+
+              read_len = g_spi_dup.rx_len;
+              memcpy(g_spi_local_buf, g_spi_dup.rx, read_len);
+              g_spi_dup.rx_len = 0;
+            }
+          else
+#endif
+            {
+              read_len = spi_read_frame(g_spi_local_buf + pre,
+                                        GHIFP_HEADER_SIZE - pre);
+            }
 
           while (read_len < 0){
               printf("Failed to read header1:%d ", read_len);
-              read_len = spi_read(g_spi_local_buf, GHIFP_HEADER_SIZE, 0);
+              read_len = spi_read_frame(g_spi_local_buf + pre,
+                                        GHIFP_HEADER_SIZE - pre);
           }
 
+          read_len += pre;
+          pre = 0;
+
           finished_size = read_len;
 
           ret = check_header(g_spi_local_buf, &opc, &opr_len);
@@ -156,74 +383,45 @@ static int spi_recv_task(int argc, FAR char *argv[])
               }
             printf("\n");
             UNLOCK();
+            continue;
           } else {
-            printf("%d  ", opc);
+            HIF_DBG("%d  ", opc);
           }
         }
-      UNLOCK();
 
-      // send every 1024byte
-      int rec_size = GHIFP_DATA_SIZE(opr_len) + GHIFP_HEADER_SIZE;
+      /* Gacrux sends one more word after the frame. */
 
-#ifdef Bit16Test
-      int align = (rec_size % 2) ? 1 : 0;
-      rec_size += (align + 2);
-#else
-      rec_size += 1;
-#endif
-
-      int num = rec_size / 1024 + ((rec_size % 1024) ? 0 : -1);
-      int first = 1;
+      rec_size = GHIFP_DATA_SIZE(opr_len) + GHIFP_HEADER_SIZE;
+      rec_size = SPI_WORD_LEN(rec_size + SPI_WORD_BYTES);
 
-      while (num--) {
-        printf("num:%d\n", num);
-        if (first) {
-          ret = spi_read(g_spi_local_buf + finished_size, 1024 - finished_size, 0);
-          while (ret != 1024 - finished_size) {
-            printf("Failed to read data0:%d\n", ret);
-            ret = spi_read(g_spi_local_buf + finished_size, 1024 - finished_size, 0);
-          }
-          first = 0;
-          finished_size += 1024 - finished_size;
-        }
-        else
+      if (LOCAL_BUFF_SZ < rec_size)
         {
-          ret = spi_read(g_spi_local_buf + finished_size, 1024, 0);
-          while (ret != 0)
-            {
-              printf("Failed to read data0:%d\n", ret);
-              ret = spi_read(g_spi_local_buf + finished_size, 1024, 0);
-            }
-            finished_size += 1024;
-        }
-        ret = bus_req_wait_spi();
-         if (ret != 0) {
-          printf("Failed to wait bus req:%d\n", ret);
+          printf("Too long frame. opr len: %d (SPI)\n", opr_len);
+          UNLOCK();
           continue;
         }
-      }
 
-      int read_size = rec_size % 1024;
-      if (first) {
-        read_size = (rec_size - finished_size) % 1024;
-      }
+      ret = spi_read_rest(g_spi_local_buf, finished_size, rec_size);
+      if (ret < 0)
+        {
+          UNLOCK();
 
-      if (opc == 128) {
-        ret = spi_read(g_spi_local_buf + finished_size, read_size, 0);
-      } else {
-        ret = spi_read(g_spi_local_buf + finished_size, read_size, 0);
-      }
+          /* Fail the waiting command instead of its response timeout. */
 
-      if (ret < 0) {
-        printf("Failed to read data:%d, read_size: %d\n", ret, read_size);
-        // ret = spi_read(g_spi_local_buf + finished_size, read_size, 0);
-      }
-      UNLOCK();
+          if (!is_evt_data(opc) &&
+              get_host_if_state(HOST_IF_CH) == HOST_IF_STATE_WAIT_RESPONSE)
+            {
+              push_dataframe_error(HOST_IF_CH, ret);
+            }
+
+          continue;
+        }
 
       /* Check data */
       ret = check_data(g_spi_local_buf + GHIFP_HEADER_SIZE, opr_len);
       if (ret != 0)
         {
+          UNLOCK();
           printf("Invalid data. opr len: %d (SPI)\n", opr_len);
           for (i = 0; i < rec_size; i++){
             printf("%d ", g_spi_local_buf[i]);
@@ -235,9 +433,17 @@ static int spi_recv_task(int argc, FAR char *argv[])
           //   printf("%d ", g_spi_local_buf[GHIFP_HEADER_SIZE + i]);
           // }
           // printf("\n");
-          printf("opr_len: %d\n", opr_len);
+          HIF_DBG("opr_len: %d\n", opr_len);
         }
 
+      /* Posted before the bus goes, so the next write does not take it
+       * for a response to itself.
+       */
+
+      rx_stat_frame(&g_spi_rx_stat, GHIFP_FRAME_SIZE(opr_len), &start);
+      sem_post(&g_spi_ready_sem);
+      UNLOCK();
+
       if (true == is_evt_data(opc)) {
         /* OPC type -> Event, notify by callback. */
         if (g_evt_cb) {
@@ -245,8 +451,8 @@ static int spi_recv_task(int argc, FAR char *argv[])
         }
       } else {
         /* OPC type -> Normal response, push to queue. */
-        if (get_host_if_state() == HOST_IF_STATE_WAIT_RESPONSE) {
-            ret = push_dataframe(g_spi_local_buf,
+        if (get_host_if_state(HOST_IF_CH) == HOST_IF_STATE_WAIT_RESPONSE) {
+            ret = push_dataframe(HOST_IF_CH, g_spi_local_buf,
                                   GHIFP_FRAME_SIZE(opr_len));
             if (ret != 0) {
                 printf("Failed to push dataframe.\n");
@@ -254,7 +460,6 @@ static int spi_recv_task(int argc, FAR char *argv[])
               }
         } else {
           // printf("Discard dataframe.\n");
-          UNLOCK();
         }
       }
     }
@@ -270,27 +475,198 @@ static int spi_recv_task(int argc, FAR char *argv[])
   return 0;
 }
 
-static int spi_write(FAR uint8_t *data, uint32_t sz)
+/* Clock sz bytes out of tx and into rx at once. Either may be NULL.
+ *
+ * The byte stream is sent in words of the data frame size, byte 0 as
+ * the least significant byte of word 0 as the words are in memory.
+ * The last word of tx is padded with 0, rx has to take whole words.
+ * Returns the bytes clocked, which is sz rounded up to the word size.
+ */
+
+#ifdef SPI_DMA
+/* Clock whole words by DMA. A NULL or unaligned buffer is replaced by a
+ * buffer of the DMA allocator, piece by piece. The driver still runs a
+ * piece of no more than CXD56_SPI_DMATHRESHOLD words by PIO, and it is
+ * counted so.
+ */
+
+static void spi_dma_exchange(FAR const uint8_t *tx, FAR uint8_t *rx,
+                             uint32_t sz)
 {
-  uint32_t write_len;
+  FAR const uint8_t *t;
+  FAR uint8_t       *r;
+  uint32_t          pos;
+  uint32_t          n;
 
-  if (g_spi_dfs == SPI_DEFAULT_DFS)
+  for (pos = 0; pos < sz; pos += n)
     {
-      write_len = sz;
-      SPI_EXCHANGE(g_dev, data, NULL, write_len);
-      return (int)sz;
+      n = sz - pos;
+      if (g_spi_dma.piece < n)
+        {
+          n = g_spi_dma.piece;
+        }
+
+      if (!tx)
+        {
+          t = g_spi_dma.zero;
+        }
+      else if (HOST_IF_DMA_ALIGNED(tx + pos))
+        {
+          t = tx + pos;
+        }
+      else
+        {
+          memcpy(g_spi_dma.tx_bounce, tx + pos, n);
+          t = g_spi_dma.tx_bounce;
+        }
+
+      if (rx && HOST_IF_DMA_ALIGNED(rx + pos))
+        {
+          r = rx + pos;
+        }
+      else
+        {
+          r = g_spi_dma.rx_bounce;
+        }
+
+      SPI_EXCHANGE(g_dev, t, r, n / SPI_HW_WORD_BYTES);
+
+      if (rx && r == g_spi_dma.rx_bounce)
+        {
+          memcpy(rx + pos, r, n);
+        }
+
+      if (CONFIG_CXD56_SPI_DMATHRESHOLD < n / SPI_HW_WORD_BYTES)
+        {
+          g_spi_dma.dma_bytes += n;
+        }
+      else
+        {
+          g_spi_dma.pio_bytes += n;
+        }
     }
-  else if (g_spi_dfs == 16)
+}
+#endif
+
+/* Clock sz bytes of whole controller words. */
+
+static void spi_exchange_words(FAR const uint8_t *tx, FAR uint8_t *rx,
+                               uint32_t sz)
+{
+#ifdef SPI_DMA
+  if (g_spi_dma.ok && SPI_DMA_THRESHOLD <= sz)
     {
-      write_len = (int)(sz+1)/2;
-      SPI_EXCHANGE(g_dev, data, NULL, write_len);
-      return (sz%2 == 1) ? (int)(sz + 1) : (int)sz;
+      spi_dma_exchange(tx, rx, sz);
     }
   else
+    {
+      SPI_EXCHANGE(g_dev, tx, rx, sz / SPI_HW_WORD_BYTES);
+      g_spi_dma.pio_bytes += sz;
+    }
+#else
+  SPI_EXCHANGE(g_dev, tx, rx, sz / SPI_HW_WORD_BYTES);
+#endif
+}
+
+/* Swap the 16-bit halves of each 32-bit word in place. */
+
+static void spi_swap_half(FAR uint8_t *buf, uint32_t sz)
+{
+  uint32_t i;
+  uint8_t  b0;
+  uint8_t  b1;
+
+  for (i = 0; i + 4 <= sz; i += 4)
+    {
+      b0         = buf[i];
+      b1         = buf[i + 1];
+      buf[i]     = buf[i + 2];
+      buf[i + 1] = buf[i + 3];
+      buf[i + 2] = b0;
+      buf[i + 3] = b1;
+    }
+}
+
+/* A 32-bit word goes as two 16-bit words, the upper half first, so the
+ * bits on the line are those of one 32-bit word. The halves are swapped
+ * through g_spi_swap_tx/rx piece by piece.
+ */
+
+static void spi_exchange32(FAR const uint8_t *tx, FAR uint8_t *rx,
+                           uint32_t sz)
+{
+  uint32_t clk = SPI_WORD_LEN(sz);
+  uint32_t pos;
+  uint32_t n;
+
+  for (pos = 0; pos < clk; pos += n)
+    {
+      n = clk - pos;
+      if (SPI_SWAP_SZ < n)
+        {
+          n = SPI_SWAP_SZ;
+        }
+
+      if (tx)
+        {
+          memset(g_spi_swap_tx, 0, n);
+          memcpy(g_spi_swap_tx, tx + pos, (sz - pos < n) ? sz - pos : n);
+          spi_swap_half(g_spi_swap_tx, n);
+        }
+
+      spi_exchange_words(tx ? g_spi_swap_tx : NULL,
+                         rx ? g_spi_swap_rx : NULL, n);
+
+      if (rx)
+        {
+          spi_swap_half(g_spi_swap_rx, n);
+          memcpy(rx + pos, g_spi_swap_rx, n);
+        }
+    }
+}
+
+static int spi_exchange(FAR const uint8_t *tx, FAR uint8_t *rx,
+                        uint32_t sz)
+{
+  uint32_t wb = SPI_WORD_BYTES;
+  uint32_t whole;
+  uint8_t  tail[SPI_WORD_BYTES_MAX];
+
+  if (g_spi_dfs != 8 && g_spi_dfs != 16 && g_spi_dfs != 32)
     {
       printf("Invalid dfs.\n");
       return -ENOTSUP;
     }
+
+  if (g_spi_dfs == 32)
+    {
+      spi_exchange32(tx, rx, sz);
+      return (int)SPI_WORD_LEN(sz);
+    }
+
+  whole = sz - (sz % wb);
+  if (whole)
+    {
+      spi_exchange_words(tx, rx, whole);
+    }
+
+  if (whole < sz)
+    {
+      memset(tail, 0, sizeof(tail));
+      if (tx)
+        {
+          memcpy(tail, tx + whole, sz - whole);
+        }
+
+      SPI_EXCHANGE(g_dev, tx ? tail : NULL, rx ? rx + whole : NULL, 1);
+    }
+
+  return (int)SPI_WORD_LEN(sz);
+}
+
+static int spi_write(FAR uint8_t *data, uint32_t sz)
+{
+  return spi_exchange(data, NULL, sz);
 }
 
 static int spi_read(FAR uint8_t *buf, uint32_t sz, int test)
@@ -309,41 +685,503 @@ static int spi_read(FAR uint8_t *buf, uint32_t sz, int test)
         tx_buf[4] = 0x85;
         SPI_EXCHANGE(g_dev, tx_buf, buf, read_len);
       } else {
-        SPI_EXCHANGE(g_dev, NULL, buf, read_len);
+        spi_exchange(NULL, buf, read_len);
       }
       return (int)sz;
     }
-  else if (g_spi_dfs == 16)
+  else
     {
-      read_len = (int)(sz+1)/2;
-      SPI_EXCHANGE(g_dev, NULL, buf, read_len);
-      return (sz%2 == 1) ? (int)(sz + 1) : (int)sz;
+      return spi_exchange(NULL, buf, sz);
     }
-  else
+}
+
+/* Read a part of a frame with LOCK() held. A frame waiting in
+ * spi_write_frame() is sent in the same clocks.
+ */
+
+static int spi_read_frame(FAR uint8_t *buf, uint32_t sz)
+{
+#ifdef SPI_FULL_DUPLEX
+  uint32_t n = 0;
+  uint32_t clk = SPI_WORD_LEN(sz);
+
+  pthread_mutex_lock(&g_spi_dup.lock);
+  if (g_spi_dup.tx)
     {
-      printf("Invalid dfs.\n");
-      return -ENOTSUP;
+      n = g_spi_dup.tx_len - g_spi_dup.tx_pos;
+      if (clk < n)
+        {
+          n = clk;
+        }
+
+      memcpy(g_spi_dup.tx_buf, g_spi_dup.tx + g_spi_dup.tx_pos, n);
+      memset(g_spi_dup.tx_buf + n, 0, clk - n);
+      g_spi_dup.tx_pos += n;
     }
+  pthread_mutex_unlock(&g_spi_dup.lock);
+
+  if (n)
+    {
+      g_spi_dup.tx_shared += n;
+      return spi_exchange(g_spi_dup.tx_buf, buf, sz);
+    }
+#endif
+
+  return spi_read(buf, sz, 0);
 }
 
-static int spi_dummy_exchange(void)
+#ifdef SPI_FULL_DUPLEX
+/* Write with LOCK() held and keep a frame Gacrux sends meanwhile for
+ * spi_recv_task.
+ */
+
+static void spi_write_capture(FAR uint8_t *data, uint32_t sz)
 {
-  uint8_t dummy[2] = {0x0}; /* Consider 16 bit DFS. */
-  uint8_t dummy_recv[2] = {0x0}; /* Consider 16 bit DFS. */
+  int      ret;
+  uint8_t  opc;
+  uint16_t opr_len;
+  uint32_t n = sz;
+
+  if (g_spi_dup.rx_len)
+    {
+      /* The last one is not taken yet. */
 
-  SPI_EXCHANGE(g_dev, &dummy, &dummy_recv, 1);
+      spi_write(data, sz);
+      return;
+    }
 
-  if (g_spi_dfs == SPI_DEFAULT_DFS)
+  if (LOCAL_BUFF_SZ - 1 < n)
     {
-      printf("Dummy packet -> 0x%02X\n",
-             dummy_recv[0]);
+      n = LOCAL_BUFF_SZ - 1;
     }
-  else
+
+  ret = spi_exchange(data, g_spi_dup.rx, n);
+  if (0 < ret && check_header(g_spi_dup.rx, &opc, &opr_len) == 0)
+    {
+      g_spi_dup.rx_len     = (uint32_t)ret;
+      g_spi_dup.rx_shared += (uint32_t)ret;
+    }
+
+  if (n < sz)
+    {
+      spi_write(data + n, sz - n);
+    }
+}
+#endif
+
+/* Write a frame. While spi_recv_task holds the bus, the frame is sent
+ * with its reads, the rest after it.
+ */
+
+static void spi_write_frame(FAR uint8_t *data, uint32_t sz)
+{
+#ifdef SPI_FULL_DUPLEX
+  uint32_t pos = 0;
+  bool     shared = false;
+
+  spi_ready_wait();
+
+  pthread_mutex_lock(&g_spi_dup.lock);
+  if (!g_spi_dup.tx)
+    {
+      g_spi_dup.tx     = data;
+      g_spi_dup.tx_len = sz;
+      g_spi_dup.tx_pos = 0;
+      shared = true;
+    }
+  pthread_mutex_unlock(&g_spi_dup.lock);
+
+  LOCK(SPI_BUS_PRIO_TX);
+  spi_apply_class();
+  spi_ready_reset();
+
+  if (shared)
+    {
+      pthread_mutex_lock(&g_spi_dup.lock);
+      pos = g_spi_dup.tx_pos;
+      g_spi_dup.tx = NULL;
+      pthread_mutex_unlock(&g_spi_dup.lock);
+    }
+
+  if (pos < sz)
+    {
+      spi_write_capture(data + pos, sz - pos);
+    }
+
+  clock_gettime(CLOCK_REALTIME, &g_spi_tx_end);
+  UNLOCK();
+#else
+  spi_ready_wait();
+
+  LOCK(SPI_BUS_PRIO_TX);
+  spi_apply_class();
+  spi_ready_reset();
+  spi_write(data, sz);
+  clock_gettime(CLOCK_REALTIME, &g_spi_tx_end);
+  UNLOCK();
+#endif
+
+#ifndef BUS_REQ_ENABLE
+  spi_poll_kick();
+#endif
+}
+
+/* Wait until Gacrux can take the next frame. A frame received since the
+ * last write shows it is ready, otherwise the gap is slept out.
+ */
+
+static void spi_ready_wait(void)
+{
+  struct timespec deadline = g_spi_tx_end;
+
+  deadline.tv_sec  += SPI_FRAME_GAP_US / 1000000;
+  deadline.tv_nsec += (SPI_FRAME_GAP_US % 1000000) * 1000;
+  if (1000000000 <= deadline.tv_nsec)
     {
-      printf("Dummy packet -> 0x%02X, 0x%02X\n",
-             dummy_recv[0], dummy_recv[1]);
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+
+  while (sem_timedwait(&g_spi_ready_sem, &deadline) != 0)
+    {
+      if (errno != EINTR)
+        {
+          break;
+        }
+    }
+}
+
+#ifndef BUS_REQ_ENABLE
+/* A command was sent, poll by the shortest interval for its response. */
+
+static void spi_poll_kick(void)
+{
+  g_spi_poll_fast = SPI_POLL_FAST_NUM;
+  sem_post(&g_spi_poll_sem);
+}
+
+/* Sleep the poll interval, a sent command ends it at once. */
+
+static void spi_poll_wait(uint32_t us)
+{
+  struct timespec abs_time;
+
+  clock_gettime(CLOCK_REALTIME, &abs_time);
+  abs_time.tv_sec  += us / 1000000;
+  abs_time.tv_nsec += (us % 1000000) * 1000;
+  if (1000000000 <= abs_time.tv_nsec)
+    {
+      abs_time.tv_sec++;
+      abs_time.tv_nsec -= 1000000000;
+    }
+
+  sem_timedwait(&g_spi_poll_sem, &abs_time);
+}
+
+/* Poll Gacrux for a frame by one word. Gacrux sends SYNC first when it
+ * has a frame, anything else otherwise. The word is kept as the start
+ * of the header in *pre bytes, and the bus stays held for the frame.
+ * The interval is short after a command, doubles while idle, and is
+ * skipped after a frame since more often follow.
+ */
+
+static int spi_poll_status(FAR uint32_t *pre)
+{
+  int ret;
+
+  if (g_spi_poll_us)
+    {
+      spi_poll_wait(g_spi_poll_us);
+    }
+
+  LOCK(SPI_BUS_PRIO_POLL);
+  spi_apply_class();
+
+#ifdef SPI_FULL_DUPLEX
+  if (g_spi_dup.rx_len)
+    {
+      /* A write received the frame start. */
+
+      g_spi_poll_us = 0;
+      *pre = 0;
+      return 0;
+    }
+#endif
+
+  ret = spi_read_frame(g_spi_local_buf, 1);
+  if (ret < 0 || g_spi_local_buf[0] != GHIFP_SYNC)
+    {
+      UNLOCK();
+
+      if (0 < g_spi_poll_fast)
+        {
+          g_spi_poll_fast--;
+          g_spi_poll_us = SPI_POLL_MIN_US;
+        }
+      else if (g_spi_poll_us < SPI_POLL_MIN_US)
+        {
+          g_spi_poll_us = SPI_POLL_MIN_US;
+        }
+      else if (g_spi_poll_us < SPI_POLL_MAX_US)
+        {
+          g_spi_poll_us *= 2;
+          if (SPI_POLL_MAX_US < g_spi_poll_us)
+            {
+              g_spi_poll_us = SPI_POLL_MAX_US;
+            }
+        }
+
+      return -EAGAIN;
     }
 
+  g_spi_poll_us = 0;
+  *pre = (uint32_t)ret;
+
+  return 0;
+}
+
+/* Poll for the next chunk of a frame with LOCK() held. Gacrux cannot
+ * stretch the SPI clock, so it answers a word with SYNC once the chunk
+ * is loaded. The word is not part of the chunk.
+ */
+
+static int spi_poll_chunk(void)
+{
+  uint8_t  word[SPI_WORD_BYTES_MAX];
+  uint32_t waited_us = 0;
+  int      ret;
+
+  while (1)
+    {
+      ret = spi_read_frame(word, 1);
+      if (0 < ret && word[0] == GHIFP_SYNC)
+        {
+          return 0;
+        }
+
+      if (RECV_TIMEOUT_SEC * 1000000 <= waited_us)
+        {
+          return -ETIMEDOUT;
+        }
+
+      usleep(SPI_POLL_MIN_US);
+      waited_us += SPI_POLL_MIN_US;
+    }
+}
+#endif
+
+/* Set the clock of the current class with LOCK() held, at a frame
+ * boundary.
+ */
+
+static void spi_apply_class(void)
+{
+  uint32_t freq = g_spi_freq;
+
+  if (g_spi_class == HOST_IF_CLASS_CONTROL && SPI_CTRL_CLK_NO < g_spi_clk_no)
+    {
+      freq = g_spi_ctrl_freq;
+    }
+
+  if (freq != g_spi_cur_freq)
+    {
+      SPI_LOCK(g_dev, true);
+      SPI_SETFREQUENCY(g_dev, freq);
+      SPI_LOCK(g_dev, false);
+      g_spi_cur_freq = freq;
+      g_spi_class_switches++;
+    }
+}
+
+/* Only frames after the write about to start count as ready. Call
+ * with LOCK() held, so a response to the write cannot come in between.
+ */
+
+static void spi_ready_reset(void)
+{
+  while (sem_trywait(&g_spi_ready_sem) == 0);
+}
+
+/* Read the rest of a frame of frame_len bytes with LOCK() held, len
+ * bytes of it are already in buf. A chunk not requested, or not ready
+ * when polled, within RECV_TIMEOUT_SEC ends the frame, so the bus is not
+ * held forever.
+ */
+
+static int spi_read_rest(FAR uint8_t *buf, uint32_t len,
+                         uint32_t frame_len)
+{
+  int      ret;
+  uint32_t n;
+  uint32_t chunk = g_spi_rx_chunk;
+
+  while (len < frame_len)
+    {
+#ifdef BUS_REQ_ENABLE
+      if ((len % chunk) == 0)
+        {
+          ret = bus_req_timedwait_spi(RECV_TIMEOUT_SEC * 1000);
+          if (ret != 0)
+            {
+              printf("Frame dropped at %lu of %lu bytes:%d (SPI)\n",
+                     len, frame_len, ret);
+              return ret;
+            }
+
+          g_spi_rx_stat.bus_reqs++;
+        }
+#else
+      if ((len % chunk) == 0)
+        {
+          ret = spi_poll_chunk();
+          if (ret != 0)
+            {
+              printf("Frame dropped at %lu of %lu bytes:%d (SPI)\n",
+                     len, frame_len, ret);
+              return ret;
+            }
+        }
+#endif
+
+      n = chunk - (len % chunk);
+      if (frame_len - len < n)
+        {
+          n = frame_len - len;
+        }
+
+      ret = spi_read_frame(&buf[len], n);
+      if (ret < 0)
+        {
+          printf("Failed to read data:%d, read_size: %lu\n", ret, n);
+          return ret;
+        }
+
+      len += (uint32_t)ret;
+    }
+
+  return 0;
+}
+
+#ifdef SPI_FULL_DUPLEX
+static void spi_duplex_free(void)
+{
+  host_if_dma_free(g_spi_dup.tx_buf);
+  g_spi_dup.tx_buf = NULL;
+  host_if_dma_free(g_spi_dup.rx);
+  g_spi_dup.rx = NULL;
+  pthread_mutex_destroy(&g_spi_dup.lock);
+}
+#endif
+
+#ifdef SPI_DMA
+/* Set the DMA word width to the data frame size. Call with LOCK() held
+ * or before the receive task starts.
+ */
+
+static void spi_dma_config(void)
+{
+  dma_config_t conf;
+  uint8_t      width;
+
+  if (!g_spi_dma.ok)
+    {
+      return;
+    }
+
+  width = (SPI_HW_BITS == 16) ? CXD56_DMAC_WIDTH16 : CXD56_DMAC_WIDTH8;
+
+  conf.channel_cfg = CXD56_DMA_PERIPHERAL_SPI4_TX;
+  conf.dest_width  = width;
+  conf.src_width   = width;
+  cxd56_spi_dmaconfig(SPI4_BUS, CXD56_SPI_DMAC_CHTYPE_TX,
+                      g_spi_dma.tx, &conf);
+
+  conf.channel_cfg = CXD56_DMA_PERIPHERAL_SPI4_RX;
+  cxd56_spi_dmaconfig(SPI4_BUS, CXD56_SPI_DMAC_CHTYPE_RX,
+                      g_spi_dma.rx, &conf);
+}
+
+static void spi_dma_free(void)
+{
+  g_spi_dma.ok = false;
+  host_if_dma_free(g_spi_dma.zero);
+  g_spi_dma.zero = NULL;
+  host_if_dma_free(g_spi_dma.tx_bounce);
+  g_spi_dma.tx_bounce = NULL;
+  host_if_dma_free(g_spi_dma.rx_bounce);
+  g_spi_dma.rx_bounce = NULL;
+}
+
+/* Falls back to PIO when a channel or a buffer is not available. */
+
+static void spi_dma_init(void)
+{
+  uint32_t piece = SPI_DMA_PIECE_MAX;
+
+  g_spi_dma.ok        = false;
+  g_spi_dma.dma_bytes = 0;
+  g_spi_dma.pio_bytes = 0;
+
+  /* The driver keeps using the channels after host_if_spi_delete(),
+   * so they are taken only once.
+   */
+
+  if (!g_spi_dma.tx)
+    {
+      g_spi_dma.tx = cxd56_dmachannel(CONFIG_CXD56_DMAC_SPI4_TX_CH,
+                                      CONFIG_CXD56_DMAC_SPI4_TX_MAXSIZE);
+    }
+
+  if (!g_spi_dma.rx)
+    {
+      g_spi_dma.rx = cxd56_dmachannel(CONFIG_CXD56_DMAC_SPI4_RX_CH,
+                                      CONFIG_CXD56_DMAC_SPI4_RX_MAXSIZE);
+    }
+
+  if (CONFIG_CXD56_DMAC_SPI4_TX_MAXSIZE < piece)
+    {
+      piece = CONFIG_CXD56_DMAC_SPI4_TX_MAXSIZE;
+    }
+
+  if (CONFIG_CXD56_DMAC_SPI4_RX_MAXSIZE < piece)
+    {
+      piece = CONFIG_CXD56_DMAC_SPI4_RX_MAXSIZE;
+    }
+
+  g_spi_dma.piece     = piece & ~(uint32_t)(SPI_WORD_BYTES_MAX - 1);
+  g_spi_dma.zero      = (FAR uint8_t *)host_if_dma_alloc(g_spi_dma.piece);
+  g_spi_dma.tx_bounce = (FAR uint8_t *)host_if_dma_alloc(g_spi_dma.piece);
+  g_spi_dma.rx_bounce = (FAR uint8_t *)host_if_dma_alloc(g_spi_dma.piece);
+
+  if (!g_spi_dma.tx || !g_spi_dma.rx || !g_spi_dma.zero ||
+      !g_spi_dma.tx_bounce || !g_spi_dma.rx_bounce)
+    {
+      printf("SPI DMA is not available, PIO is used.\n");
+      spi_dma_free();
+      return;
+    }
+
+  memset(g_spi_dma.zero, 0, g_spi_dma.piece);
+  g_spi_dma.ok = true;
+  spi_dma_config();
+}
+#endif
+
+static int spi_dummy_exchange(void)
+{
+  uint8_t  dummy[SPI_WORD_BYTES_MAX] = {0x0};
+  uint8_t  dummy_recv[SPI_WORD_BYTES_MAX] = {0x0};
+  uint32_t i;
+
+  spi_exchange(dummy, dummy_recv, SPI_WORD_BYTES);
+
+  printf("Dummy packet ->");
+  for (i = 0; i < SPI_WORD_BYTES; i++)
+    {
+      printf(" 0x%02X", dummy_recv[i]);
+    }
+  printf("\n");
+
   return 0;
 }
 
@@ -363,7 +1201,7 @@ static FAR struct spi_dev_s *spi_dev_init(void)
 
   SPI_LOCK(dev, true);
   SPI_SETMODE(dev, SPIDEV_MODE0);
-  SPI_SETBITS(dev, g_spi_dfs);
+  SPI_SETBITS(dev, SPI_HW_BITS);
   SPI_SETFREQUENCY(dev, g_spi_freq);
   SPI_LOCK(dev, false);
 
@@ -387,6 +1225,9 @@ static int conv_spi_dfs_number(uint8_t dfs_no)
       case DFS_SPI_16:
         return 16;
         break;
+      case DFS_SPI_32:
+        return 32;
+        break;
       default:
         break;
     }
@@ -406,10 +1247,15 @@ static int change_dfs(uint8_t dfs_number)
   else
     {
       printf("Change Data Frame Size. %u -> %u\n", g_spi_dfs, ret);
+      LOCK(SPI_BUS_PRIO_TX);
       g_spi_dfs = ret;
       SPI_LOCK(g_dev, true);
-      SPI_SETBITS(g_dev, g_spi_dfs);
+      SPI_SETBITS(g_dev, SPI_HW_BITS);
       SPI_LOCK(g_dev, false);
+#ifdef SPI_DMA
+      spi_dma_config();
+#endif
+      UNLOCK();
     }
 
   /* No need to re-create task.
@@ -428,7 +1274,13 @@ static int change_dfs(uint8_t dfs_number)
 
 static int change_dfs_old(int dfs)
 {
-  if (16 <= dfs)
+  LOCK(SPI_BUS_PRIO_TX);
+
+  if (32 <= dfs)
+    {
+      g_spi_dfs = 32;
+    }
+  else if (16 <= dfs)
     {
       g_spi_dfs = 16;
     }
@@ -439,8 +1291,13 @@ static int change_dfs_old(int dfs)
     }
   printf("Set SPI data frame size -> %d\n", g_spi_dfs);
   SPI_LOCK(g_dev, true);
-  SPI_SETBITS(g_dev, g_spi_dfs);
+  SPI_SETBITS(g_dev, SPI_HW_BITS);
   SPI_LOCK(g_dev, false);
+#ifdef SPI_DMA
+  spi_dma_config();
+#endif
+
+  UNLOCK();
 
   return 0;
 }
@@ -489,10 +1346,11 @@ static int set_clock(int clk_no)
   if (0 < new_clock)
     {
       printf("Change SPI frequency. %lu -> %ld\n", g_spi_freq, new_clock);
+      LOCK(SPI_BUS_PRIO_TX);
       g_spi_freq = (uint32_t)new_clock;
-      SPI_LOCK(g_dev, true);
-      SPI_SETFREQUENCY(g_dev, g_spi_freq);
-      SPI_LOCK(g_dev, false);
+      g_spi_clk_no = (uint8_t)clk_no;
+      spi_apply_class();
+      UNLOCK();
       ret = 0;
     }
   else
@@ -532,12 +1390,9 @@ static int host_if_spi_write(
   //     return ret;
   //   }
 
-  LOCK();
-  spi_write(data, sz);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+  spi_write_frame(data, sz);
 //  spi_dummy_exchange(); /* No need to send dummy. */
-  UNLOCK();
-
-  set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
 
   return 0;
 }
@@ -548,15 +1403,15 @@ static int host_if_spi_read(
   int      ret = -EINVAL;
   uint32_t res_len;
 
-  printf("host_if_spi_read() buflen=%ld\n", sz);
+  HIF_DBG("host_if_spi_read() buflen=%ld\n", sz);
 
   if (!thiz || !buf || !sz)
     {
       return ret;
     }
 
-  ret = pop_dataframe(buf, sz, &res_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, sz, &res_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
@@ -564,7 +1419,7 @@ static int host_if_spi_read(
     }
   else
     {
-      printf("Response dataframe len:%ld\n", res_len);
+      HIF_DBG("Response dataframe len:%ld\n", res_len);
       return res_len;
     }
 }
@@ -580,7 +1435,7 @@ static int host_if_spi_transaction(
 //  uint8_t  opc;
 //  uint16_t opr_len;
 
-  printf("SPI transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
+  HIF_DBG("SPI transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
 
   if (!thiz || !data || !w_sz || !buf || !r_sz || !res_len)
     {
@@ -602,14 +1457,12 @@ static int host_if_spi_transaction(
   //     return ret;
   //   }
 
-  LOCK();
-  spi_write(data, w_sz);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+  spi_write_frame(data, w_sz);
 //  spi_dummy_exchange(); /* No need to send dummy. */
-  UNLOCK();
-  set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
 
-  ret = pop_dataframe(buf, r_sz, &df_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, r_sz, &df_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
@@ -617,7 +1470,7 @@ static int host_if_spi_transaction(
     }
   else
     {
-      printf("Response dataframe len:%ld\n", df_len);
+      HIF_DBG("Response dataframe len:%ld\n", df_len);
       *res_len = df_len;
     }
 
@@ -631,7 +1484,7 @@ static int host_if_spi_dbg_write(
 {
   int ret = -EINVAL;
 
-  printf("host_if_spi_dbg_write() len=%ld\n", sz);
+  HIF_DBG("host_if_spi_dbg_write() len=%ld\n", sz);
 
   if (!thiz || !data || !sz)
     {
@@ -643,9 +1496,7 @@ static int host_if_spi_dbg_write(
       return -EPERM;
     }
 
-  LOCK();
-  spi_write(data, sz);
-  UNLOCK();
+  spi_write_frame(data, sz);
 
   return 0;
 }
@@ -669,8 +1520,8 @@ static int host_if_spi_set_config(
         g_spi_dbg_recv = atoi((char *)arg);
         printf("Debug receive mode:%s\n",
                g_spi_dbg_recv ? "ON" : "OFF");
-        ret = restart_task(g_spi_task_pid, "ghifp_spi_task",
-                           spi_recv_task, NULL);
+        host_if_bus_stop_task(&g_spi_bus, g_spi_task_pid);
+        ret = start_task("ghifp_spi_task", spi_recv_task, NULL);
         if (0 < ret)
           {
             g_spi_task_pid = ret;
@@ -679,9 +1530,61 @@ static int host_if_spi_set_config(
       case HOST_IF_SET_CONFIG_REQ_SETSPICLK:
         ret = set_clock(atoi((char *)arg));
         break;
+      case HOST_IF_SET_CONFIG_REQ_GETSPICLK:
+        *(uint8_t *)arg = g_spi_clk_no;
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_SETCLASS:
+        g_spi_class = *(uint8_t *)arg; /* Applied by the next frame */
+        ret = 0;
+        break;
       case HOST_IF_SET_CONFIG_REQ_SETSLVCONF:
         ret = change_dfs(*(uint8_t *)arg);
         break;
+      case HOST_IF_SET_CONFIG_REQ_GETSLVCONF:
+        *(uint8_t *)arg = (g_spi_dfs == 32) ? DFS_SPI_32 :
+                          (g_spi_dfs == 16) ? DFS_SPI_16 : DFS_SPI_8;
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_PRINTSTAT:
+        rx_stat_print(&g_spi_rx_stat, g_spi_rx_chunk);
+        host_if_bus_print(&g_spi_bus, *(uint8_t *)arg);
+        printf("Clock %lu Hz bulk, %lu Hz control, %lu switches\n",
+               g_spi_freq,
+               SPI_CTRL_CLK_NO < g_spi_clk_no ? g_spi_ctrl_freq : g_spi_freq,
+               g_spi_class_switches);
+#ifdef SPI_FULL_DUPLEX
+        printf("Full duplex: %lu bytes sent with reads, "
+               "%lu bytes received with writes\n",
+               g_spi_dup.tx_shared, g_spi_dup.rx_shared);
+#endif
+#ifdef SPI_DMA
+        printf("DMA: %lu bytes, PIO: %lu bytes%s\n",
+               g_spi_dma.dma_bytes, g_spi_dma.pio_bytes,
+               g_spi_dma.ok ? "" : " (DMA not available)");
+#endif
+        host_if_dma_print();
+        if (*(uint8_t *)arg)
+          {
+            memset(&g_spi_rx_stat, 0, sizeof(g_spi_rx_stat));
+            g_spi_class_switches = 0;
+#ifdef SPI_FULL_DUPLEX
+            g_spi_dup.tx_shared = 0;
+            g_spi_dup.rx_shared = 0;
+#endif
+#ifdef SPI_DMA
+            g_spi_dma.dma_bytes = 0;
+            g_spi_dma.pio_bytes = 0;
+#endif
+          }
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_SETCHUNK:
+        printf("Change chunk size. %lu -> %u\n",
+               g_spi_rx_chunk, *(uint16_t *)arg);
+        g_spi_rx_chunk = *(uint16_t *)arg;
+        ret = 0;
+        break;
       default:
         printf("Nothing to do in SPI mode.\n");
         break;
@@ -706,7 +1609,7 @@ FAR struct host_if_s *host_if_spi_create(hostif_evt_cb evt_cb)
       g_evt_cb = evt_cb;
     }
 
-  ret = pthread_mutex_init(&g_mutex, NULL);
+  ret = host_if_bus_init(&g_spi_bus);
   if (ret < 0)
     {
       goto errout;
@@ -718,12 +1621,44 @@ FAR struct host_if_s *host_if_spi_create(hostif_evt_cb evt_cb)
       goto errout;
     }
 
-  g_spi_local_buf = (FAR uint8_t *)malloc(LOCAL_BUFF_SZ);
-  if (!g_spi_local_buf)
+  memset(&g_spi_rx_stat, 0, sizeof(g_spi_rx_stat));
+  g_spi_rx_chunk = SPI_RX_CHUNK_DEFAULT;
+
+  g_spi_cur_freq       = g_spi_freq; /* Set by spi_dev_init() */
+  g_spi_ctrl_freq      = (uint32_t)conv_spi_clk_number(SPI_CTRL_CLK_NO);
+  g_spi_class          = HOST_IF_CLASS_CONTROL;
+  g_spi_class_switches = 0;
+
+  sem_init(&g_spi_ready_sem, 0, 0);
+#ifndef BUS_REQ_ENABLE
+  sem_init(&g_spi_poll_sem, 0, 0);
+  g_spi_poll_us = SPI_POLL_MIN_US;
+#endif
+  memset(&g_spi_tx_end, 0, sizeof(g_spi_tx_end));
+
+  g_spi_local_buf = (FAR uint8_t *)host_if_dma_alloc(LOCAL_BUFF_SZ);
+  g_spi_swap_tx   = (FAR uint8_t *)host_if_dma_alloc(SPI_SWAP_SZ);
+  g_spi_swap_rx   = (FAR uint8_t *)host_if_dma_alloc(SPI_SWAP_SZ);
+  if (!g_spi_local_buf || !g_spi_swap_tx || !g_spi_swap_rx)
     {
       goto errout;
     }
 
+#ifdef SPI_FULL_DUPLEX
+  memset(&g_spi_dup, 0, sizeof(g_spi_dup));
+  pthread_mutex_init(&g_spi_dup.lock, NULL);
+  g_spi_dup.tx_buf = (FAR uint8_t *)host_if_dma_alloc(LOCAL_BUFF_SZ);
+  g_spi_dup.rx     = (FAR uint8_t *)host_if_dma_alloc(LOCAL_BUFF_SZ);
+  if (!g_spi_dup.tx_buf || !g_spi_dup.rx)
+    {
+      goto errout;
+    }
+#endif
+
+#ifdef SPI_DMA
+  spi_dma_init();
+#endif
+
   g_spi_task_pid = start_task("ghifp_spi_task", spi_recv_task, NULL);
   if (g_spi_task_pid < 0)
     {
@@ -736,9 +1671,20 @@ errout:
 
   if (g_spi_local_buf)
     {
-      free(g_spi_local_buf);
+      host_if_dma_free(g_spi_local_buf);
     }
   g_spi_local_buf = NULL;
+  host_if_dma_free(g_spi_swap_tx);
+  host_if_dma_free(g_spi_swap_rx);
+  g_spi_swap_tx = NULL;
+  g_spi_swap_rx = NULL;
+
+#ifdef SPI_FULL_DUPLEX
+  spi_duplex_free();
+#endif
+#ifdef SPI_DMA
+  spi_dma_free();
+#endif
 
   if (g_dev)
     {
@@ -746,7 +1692,11 @@ errout:
       g_dev = NULL;
     }
 
-  pthread_mutex_destroy(&g_mutex);
+  host_if_bus_fin(&g_spi_bus);
+  sem_destroy(&g_spi_ready_sem);
+#ifndef BUS_REQ_ENABLE
+  sem_destroy(&g_spi_poll_sem);
+#endif
 
   g_evt_cb = NULL;
 
@@ -755,21 +1705,36 @@ errout:
 
 int host_if_spi_delete(FAR struct host_if_s *this)
 {
-  stop_task(g_spi_task_pid);
+  host_if_bus_stop_task(&g_spi_bus, g_spi_task_pid);
   g_spi_task_pid = 0;
 
   if (g_spi_local_buf)
     {
-      free(g_spi_local_buf);
+      host_if_dma_free(g_spi_local_buf);
     }
   g_spi_local_buf = NULL;
+  host_if_dma_free(g_spi_swap_tx);
+  host_if_dma_free(g_spi_swap_rx);
+  g_spi_swap_tx = NULL;
+  g_spi_swap_rx = NULL;
+
+#ifdef SPI_FULL_DUPLEX
+  spi_duplex_free();
+#endif
+#ifdef SPI_DMA
+  spi_dma_free();
+#endif
 
   if (g_dev)
     {
       spi_dev_uninit();
     }
 
-  pthread_mutex_destroy(&g_mutex);
+  host_if_bus_fin(&g_spi_bus);
+  sem_destroy(&g_spi_ready_sem);
+#ifndef BUS_REQ_ENABLE
+  sem_destroy(&g_spi_poll_sem);
+#endif
 
   g_evt_cb = NULL;
 
@@ -13,8 +13,13 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 
+#include <../../nuttx/arch/arm/src/cxd56xx/cxd56_pinconfig.h>
+
 #include "host_if.h"
 #include "host_if_bs.h"
 #include "gacrux_protocol_def.h"
@@ -23,20 +28,89 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#define LOCK()   pthread_mutex_lock(&g_uart_ses.lock)
+#define UNLOCK() pthread_mutex_unlock(&g_uart_ses.lock)
+
+#define TX_LOCK()   pthread_mutex_lock(&g_uart_tx.lock)
+#define TX_UNLOCK() pthread_mutex_unlock(&g_uart_tx.lock)
+
 #define DEV_PATH "/dev/ttyS2"
 
+#define HOST_IF_CH (HOST_IF_BS_CH_UART)
+
 #define UART_DEFAULT_BAUDRATE (B115200)
+#define UART_DEFAULT_SPEED_NO (SPEED_UART_115200BPS)
+#define UART_RX_VTIME         (1) /* Inter-byte timeout, 0.1 sec unit */
+
+#ifdef CONFIG_EXAMPLES_GHIFP_UART_TX_RING_SIZE
+#  define UART_TX_RING_SZ CONFIG_EXAMPLES_GHIFP_UART_TX_RING_SIZE
+#else
+#  define UART_TX_RING_SZ (8192)
+#endif
+
+#define UART_RESYNC_HDR_ERR_NUM (4)  /* Header errors before auto-baud */
+#define UART_PROBE_TIMEOUT_MS   (50) /* 4800bps needs about 30ms */
+
+/* RTS/CTS needs both directions in the serial driver,
+ * e.g. CONFIG_UART2_IFLOWCONTROL=y and CONFIG_UART2_OFLOWCONTROL=y.
+ */
+
+#if defined(CONFIG_SERIAL_IFLOWCONTROL) && \
+    defined(CONFIG_SERIAL_OFLOWCONTROL) && defined(CRTSCTS)
+#  define UART_FLOW_CTRL_SUPPORTED
+#endif
+
+/* Rates without a termios constant are passed as the number itself,
+ * the serial driver derives the divisor from it.
+ */
+
+#ifdef B2000000
+#  define UART_BAUD_2M  (B2000000)
+#else
+#  define UART_BAUD_2M  (2000000)
+#endif
+#ifdef B3000000
+#  define UART_BAUD_3M  (B3000000)
+#else
+#  define UART_BAUD_3M  (3000000)
+#endif
+#ifdef B4000000
+#  define UART_BAUD_4M  (B4000000)
+#else
+#  define UART_BAUD_4M  (4000000)
+#endif
+#define UART_BAUD_5M    (5000000)
+#define UART_BAUD_6M    (6000000)
+#define UART_BAUD_7M    (7000000)
+#define UART_BAUD_8M    (8000000)
+#define UART_BAUD_9M    (9000000)
+#define UART_BAUD_10M   (10000000)
 
  /****************************************************************************
  * Private Types
  ****************************************************************************/
 
 static int uart_recv_task(int argc, FAR char *argv[]);
+static int uart_read_exact(int fd, FAR uint8_t *buf, uint32_t len);
+static uint32_t uart_resync(FAR uint8_t *buf);
 static int conv_uart_speed_number(uint8_t speed_no);
-static int set_baudrate(int fd, speed_t baudrate);
+static int set_baudrate(int fd, speed_t baudrate, bool flow_ctrl);
+static int set_flow_ctrl(uint8_t flow_ctrl);
 static int change_baudrate(uint8_t speed_number);
-static int uart_open(const char *devpath, speed_t baudrate);
+static int apply_speed(uint8_t speed_number);
+static int uart_probe(uint8_t speed_number);
+static int uart_autobaud(void);
+static void uart_hdr_result(bool ok);
+static void uart_resync_check(void);
+static int uart_open(const char *devpath, speed_t baudrate,
+                     bool flow_ctrl);
 static int uart_close(int fd);
+static int uart_session_fd(void);
+static int uart_session_write(FAR uint8_t *data, uint32_t sz);
+static int uart_tx_task(int argc, FAR char *argv[]);
+static void uart_tx_flush(void);
+static int uart_tx_init(void);
+static void uart_tx_fin(void);
 static int host_if_uart_write(
   FAR struct host_if_s *thiz, FAR uint8_t *data, uint32_t sz);
 static int host_if_uart_read(
@@ -51,10 +125,48 @@ static int host_if_uart_dbg_write(
 static int host_if_uart_set_config(
   FAR struct host_if_s *thiz, uint32_t req, FAR void *arg);
 
-enum recv_state_e
+/* The port is opened and configured once by the receive task and stays
+ * open. Writers queue frames to the TX task. The descriptor here is only
+ * for termios, opened per task because NSH runs every ghifp command as
+ * a new task and a descriptor belongs to its task.
+ */
+
+struct uart_session_s
+{
+  pthread_mutex_t lock;           /* Writers, reconfiguration, recovery */
+  speed_t         baudrate;
+  uint8_t         speed_no;       /* SPEED_UART_XXX of baudrate */
+  bool            flow_ctrl;
+  bool            next_flow_ctrl; /* Applied with the next baudrate */
+  int             fd;             /* Writer fd, valid in task "pid" only */
+  pid_t           pid;
+
+  /* Link recovery */
+
+  int             hdr_err;        /* Consecutive header errors */
+  bool            resync_req;     /* Run auto-baud before next write */
+};
+
+/* Frames queued by writers and sent by the TX task, so a writer returns
+ * as soon as its frame is copied.
+ */
+
+struct uart_tx_ring_s
 {
-  RECV_STATE_WAIT_FOR_HEADER,
-  RECV_STATE_WAIT_FOR_DATA
+  pthread_mutex_t lock;
+  sem_t           data_sem;  /* Posted when queued */
+  sem_t           space_sem; /* Posted when sent */
+  sem_t           empty_sem; /* Posted when all sent, for flush */
+  sem_t           ready_sem; /* Posted when the task opened the port */
+  FAR uint8_t     *buf;
+  uint32_t        head;      /* Next write position */
+  uint32_t        tail;      /* Next send position */
+  uint32_t        len;       /* Queued, not written to the driver yet */
+  bool            data_wait; /* Who waits for which sem */
+  bool            space_wait;
+  bool            flushing;
+  int             err;       /* Reported to the next writer */
+  pid_t           pid;
 };
 
 /****************************************************************************
@@ -66,11 +178,19 @@ struct host_if_s g_uart = {
   .read = host_if_uart_read,
   .transaction = host_if_uart_transaction,
   .dbg_write = host_if_uart_dbg_write,
-  .set_config = host_if_uart_set_config
+  .set_config = host_if_uart_set_config,
+  .caps = HOST_IF_CAP_ASYNC_WRITE
 };
 
 static FAR uint8_t   *g_uart_recv_buf = NULL;
-static speed_t       g_uart_baudrate = UART_DEFAULT_BAUDRATE;
+static struct uart_session_s g_uart_ses =
+{
+  .baudrate = UART_DEFAULT_BAUDRATE,
+  .speed_no = UART_DEFAULT_SPEED_NO,
+  .fd       = -1,
+};
+static struct uart_tx_ring_s g_uart_tx;
+static uint8_t       g_uart_probe_buf[UARTCONF_RES_SIZE];
 static pid_t         g_uart_task_pid = 0;
 static hostif_evt_cb g_evt_cb = NULL;
 static int           g_uart_dbg_recv = 0;
@@ -84,14 +204,14 @@ static int uart_recv_task(int argc, FAR char *argv[])
   int                ret;
   int                i;
   int                fd;
-  uint32_t           total_sz = 0;
+  uint32_t           hdr_sz = 0; /* Header bytes kept by resync */
+  uint32_t           frame_sz;
   uint8_t            opc;
   uint16_t           opr_len;
-  enum recv_state_e  recv_stat = RECV_STATE_WAIT_FOR_HEADER;
 
   memset(g_uart_recv_buf, 0, LOCAL_BUFF_SZ);
 
-  fd = uart_open(DEV_PATH, g_uart_baudrate);
+  fd = uart_open(DEV_PATH, g_uart_ses.baudrate, g_uart_ses.flow_ctrl);
   if (fd < 0)
     {
       return fd;
@@ -116,97 +236,77 @@ static int uart_recv_task(int argc, FAR char *argv[])
           printf("\n");
           continue;
         }
-      else
+
+      /* Header first. VMIN is the header size, so this is one wake-up. */
+
+      ret = uart_read_exact(fd, g_uart_recv_buf + hdr_sz,
+                            GHIFP_HEADER_SIZE - hdr_sz);
+      if (ret < 0)
         {
-          ret = read(fd, g_uart_recv_buf + total_sz,
-                    LOCAL_BUFF_SZ - total_sz);
-          if (ret <= 0)
-            {
-              printf("Failed to read:%d\n", ret);
-              continue;
-            }
+          printf("Failed to read:%d\n", ret);
+          hdr_sz = 0;
+          continue;
         }
 
-#if 1 /* kanamori debug */
-      printf("read len:%d\n", ret);
-      for (i=total_sz; i<total_sz+ret; i++)
+      ret = check_header(g_uart_recv_buf, &opc, &opr_len);
+      if (ret != 0 || LOCAL_BUFF_SZ < GHIFP_FRAME_SIZE(opr_len))
         {
-          printf("%02X ", g_uart_recv_buf[i]);
+          printf("Invalid header.(UART)\n");
+          hdr_sz = uart_resync(g_uart_recv_buf);
+          uart_hdr_result(false);
+          continue;
+        }
+
+      uart_hdr_result(true);
+
+      hdr_sz   = 0;
+      frame_sz = GHIFP_FRAME_SIZE(opr_len);
+
+      /* Then exactly the rest of this frame, nothing of the next one. */
+
+      ret = uart_read_exact(fd, g_uart_recv_buf + GHIFP_HEADER_SIZE,
+                            frame_sz - GHIFP_HEADER_SIZE);
+      if (ret < 0)
+        {
+          printf("Failed to read:%d\n", ret);
+          continue;
+        }
+
+      ret = check_data(g_uart_recv_buf + GHIFP_HEADER_SIZE, opr_len);
+      if (ret != 0)
+        {
+          printf("Invalid data.(UART)\n");
+          continue;
         }
-      printf("\n");
-#endif
 
-      total_sz += ret;
+      HIF_DBG("Received dataframe completely. total_sz:%lu\n", frame_sz);
 
-      if (recv_stat == RECV_STATE_WAIT_FOR_HEADER)
+      /* Completed to receive dataframe. */
+
+      if (true == is_evt_data(opc))
         {
-          if (GHIFP_HEADER_SIZE <= total_sz)
+          /* OPC type -> Event, notify by callback. */
+          if (g_evt_cb)
             {
-              ret = check_header(g_uart_recv_buf, &opc, &opr_len);
-              if (ret != 0)
-                {
-                  printf("Invalid header.(UART)\n");
-                  total_sz = 0;
-                  continue;
-                }
-              recv_stat = RECV_STATE_WAIT_FOR_DATA;
+              g_evt_cb(g_uart_recv_buf, frame_sz);
             }
         }
-
-      if (recv_stat == RECV_STATE_WAIT_FOR_DATA)
+      else
         {
-          if (GHIFP_FRAME_SIZE(opr_len) <= total_sz)
+          /* OPC type -> Normal response, push to queue. */
+          if (get_host_if_state(HOST_IF_CH) ==
+              HOST_IF_STATE_WAIT_RESPONSE)
             {
-              ret = check_data(g_uart_recv_buf + GHIFP_HEADER_SIZE,
-                               opr_len);
+              ret = push_dataframe(HOST_IF_CH, g_uart_recv_buf, frame_sz);
               if (ret != 0)
                 {
-                  printf("Invalid data.(UART)\n");
-                  total_sz = 0;
-                  recv_stat = RECV_STATE_WAIT_FOR_HEADER;
+                  printf("Failed to send dataframe.\n");
                   continue;
                 }
-
-              printf("Received dataframe completely. total_sz:%lu\n",
-                     total_sz);
-
-              /* Completed to receive dataframe. */
-
-              if (true == is_evt_data(opc))
-                {
-                  /* OPC type -> Event, notify by callback. */
-                  if (g_evt_cb)
-                    {
-                      g_evt_cb(g_uart_recv_buf,
-                               GHIFP_FRAME_SIZE(opr_len));
-                    }
-                }
-              else
-                {
-                  /* OPC type -> Normal response, push to queue. */
-                  if (get_host_if_state() == HOST_IF_STATE_WAIT_RESPONSE)
-                    {
-                      ret = push_dataframe(g_uart_recv_buf,
-                                           GHIFP_FRAME_SIZE(opr_len));
-                      if (ret != 0)
-                        {
-                          printf("Failed to send dataframe.\n");
-                          continue;
-                        }
-                    }
-                  else
-                    {
-                      printf("Discard dataframe.\n");
-                    }
-                }
-
-              total_sz -= GHIFP_FRAME_SIZE(opr_len);
-              memmove(g_uart_recv_buf,
-                      g_uart_recv_buf+GHIFP_FRAME_SIZE(opr_len),
-                      LOCAL_BUFF_SZ - GHIFP_FRAME_SIZE(opr_len));
-              opc = 0;
-              opr_len = 0;
-              recv_stat = RECV_STATE_WAIT_FOR_HEADER;
+            }
+          else
+            {
+              HIF_DBG("Discard dataframe.\n");
             }
         }
     }
@@ -224,6 +324,45 @@ static int uart_recv_task(int argc, FAR char *argv[])
   return 0;
 }
 
+static int uart_read_exact(int fd, FAR uint8_t *buf, uint32_t len)
+{
+  int      ret;
+  uint32_t total_sz = 0;
+
+  while (total_sz < len)
+    {
+      ret = read(fd, buf + total_sz, len - total_sz);
+      if (ret < 0)
+        {
+          return -errno;
+        }
+
+      total_sz += ret; /* 0 is VTIME expired, just wait again. */
+    }
+
+  return total_sz;
+}
+
+/* Keep the bytes from the next SYNC in a broken header, they can be the
+ * start of the next frame. Returns the number of bytes kept.
+ */
+
+static uint32_t uart_resync(FAR uint8_t *buf)
+{
+  uint32_t i;
+
+  for (i=1; i<GHIFP_HEADER_SIZE; i++)
+    {
+      if (buf[i] == GHIFP_SYNC)
+        {
+          memmove(buf, &buf[i], GHIFP_HEADER_SIZE - i);
+          return GHIFP_HEADER_SIZE - i;
+        }
+    }
+
+  return 0;
+}
+
 static int conv_uart_speed_number(uint8_t speed_no)
 {
   switch (speed_no)
@@ -261,6 +400,33 @@ static int conv_uart_speed_number(uint8_t speed_no)
       case SPEED_UART_1000000BPS:
         return B1000000;
         break;
+      case SPEED_UART_2000000BPS:
+        return UART_BAUD_2M;
+        break;
+      case SPEED_UART_3000000BPS:
+        return UART_BAUD_3M;
+        break;
+      case SPEED_UART_4000000BPS:
+        return UART_BAUD_4M;
+        break;
+      case SPEED_UART_5000000BPS:
+        return UART_BAUD_5M;
+        break;
+      case SPEED_UART_6000000BPS:
+        return UART_BAUD_6M;
+        break;
+      case SPEED_UART_7000000BPS:
+        return UART_BAUD_7M;
+        break;
+      case SPEED_UART_8000000BPS:
+        return UART_BAUD_8M;
+        break;
+      case SPEED_UART_9000000BPS:
+        return UART_BAUD_9M;
+        break;
+      case SPEED_UART_10000000BPS:
+        return UART_BAUD_10M;
+        break;
       default:
         break;
     }
@@ -268,7 +434,7 @@ static int conv_uart_speed_number(uint8_t speed_no)
   return -EINVAL;
 }
 
-static int set_baudrate(int fd, speed_t baudrate)
+static int set_baudrate(int fd, speed_t baudrate, bool flow_ctrl)
 {
   int            ret;
   struct termios tio = {0};
@@ -279,24 +445,38 @@ static int set_baudrate(int fd, speed_t baudrate)
       return ret;
     }
 
-  printf("baudrate:%u\n", baudrate);
+  HIF_DBG("baudrate:%u\n", baudrate);
 
-  tio.c_cflag += CREAD;  /* Enable receive */
-  tio.c_cflag += CLOCAL; /* Local line, no modem control */
-  tio.c_cflag += CS8;    /* Data bit 8bit */
-  tio.c_cflag += 0;      /* Stop bit 1bit */
-  tio.c_cflag += 0;      /* Paritiy none */
-  cfsetispeed(&tio, baudrate);
-  cfsetospeed(&tio, baudrate);
+  /* Applied to the live settings, so set bits instead of adding them. */
+
+  tio.c_cflag &= ~(CSIZE | CSTOPB | PARENB);
+  tio.c_cflag |= CREAD;  /* Enable receive */
+  tio.c_cflag |= CLOCAL; /* Local line, no modem control */
+  tio.c_cflag |= CS8;    /* Data bit 8bit */
+                         /* Stop bit 1bit, Paritiy none */
+#ifdef UART_FLOW_CTRL_SUPPORTED
+  if (flow_ctrl)
+    {
+      tio.c_cflag |= CRTSCTS;
+    }
+  else
+    {
+      tio.c_cflag &= ~CRTSCTS;
+    }
+#endif
 
-  /* tty: set to tty device */
+  /* Wake up the receive task per header, not per FIFO drain. */
 
-  tcsetattr(fd, TCSAFLUSH, &tio);
+  tio.c_cc[VMIN]  = GHIFP_HEADER_SIZE;
+  tio.c_cc[VTIME] = UART_RX_VTIME;
 
-  /* tty: Enable settings */
+  cfsetispeed(&tio, baudrate);
+  cfsetospeed(&tio, baudrate);
+
+  /* tty: Enable settings. No flush, RX data not read yet is kept. */
 
   ret = ioctl(fd, TCSETS, (unsigned long)&tio);
-  printf("UART ioctl(TCSETS). ret=%d\n", ret);
+  HIF_DBG("UART ioctl(TCSETS). ret=%d\n", ret);
 
   return ret;
 }
@@ -310,18 +490,10 @@ static int change_baudrate(uint8_t speed_number)
     {
       return ret;
     }
-  else
-    {
-      printf("Change baudrate. %u -> %u\n", g_uart_baudrate, (speed_t)ret);
-      g_uart_baudrate = (speed_t)ret;
-    }
 
-  /* Apply new baudrate */
-  ret = uart_open(DEV_PATH, g_uart_baudrate);
-  if (0 < ret)
-    {
-      uart_close(ret);
-    }
+  printf("Change baudrate. %u -> %u\n", g_uart_ses.baudrate, (speed_t)ret);
+
+  ret = apply_speed(speed_number);
 
   /* No need to re-create task.
      New baudrate is applied uart_recv_task. */
@@ -338,7 +510,230 @@ static int change_baudrate(uint8_t speed_number)
   return ret;
 }
 
-static int uart_open(const char *devpath, speed_t baudrate)
+static int apply_speed(uint8_t speed_number)
+{
+  int     ret;
+  int     fd;
+  speed_t baudrate;
+
+  ret = conv_uart_speed_number(speed_number);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Apply new baudrate. Settings belong to the port, so the descriptor
+   * of the receive task follows them. The frame written just before
+   * (UARTCONF) must leave the wire with the old rate first.
+   */
+
+  uart_tx_flush();
+
+  LOCK();
+
+  baudrate = (speed_t)ret;
+  ret = uart_session_fd();
+  if (0 <= ret)
+    {
+      fd  = ret;
+      ret = tcdrain(fd);
+      if (ret < 0)
+        {
+          ret = -errno;
+          printf("UART drain error:%d\n", ret);
+        }
+      else
+        {
+          ret = set_baudrate(fd, baudrate, g_uart_ses.next_flow_ctrl);
+        }
+    }
+
+  if (ret == 0)
+    {
+      g_uart_ses.baudrate  = baudrate;
+      g_uart_ses.speed_no  = speed_number;
+      g_uart_ses.flow_ctrl = g_uart_ses.next_flow_ctrl;
+
+      /* Errors seen at the old rate say nothing about the new one */
+
+      g_uart_ses.hdr_err    = 0;
+      g_uart_ses.resync_req = false;
+    }
+  else
+    {
+      g_uart_ses.next_flow_ctrl = g_uart_ses.flow_ctrl;
+    }
+
+  UNLOCK();
+
+  return ret;
+}
+
+/* Send UARTCONF of the rate in use, so Gacrux keeps it, and wait for the
+ * response shortly. Only a device running at that rate can answer.
+ */
+
+static int uart_probe(uint8_t speed_number)
+{
+  int      ret;
+  uint8_t  cmd[UARTCONF_CMD_SIZE];
+  uint32_t res_len;
+
+  cmd[GHIFP_SYNC_OFFSET]                    = GHIFP_SYNC;
+  *(uint16_t *)&cmd[GHIFP_OPR_LEN_OFFSET]   = UARTCONF_OPR_SIZE;
+  cmd[GHIFP_OPC_OFFSET]                     = UARTCONF_OPC;
+  cmd[GHIFP_H_CHECKSUM_OFFSET]              = calc_checksum(cmd, 4);
+  cmd[GHIFP_OPR_OFFSET]                     = speed_number;
+  cmd[GHIFP_OPR_OFFSET + 1]                 = g_uart_ses.flow_ctrl;
+  cmd[GHIFP_D_CHECKSUM_OFFSET(UARTCONF_OPR_SIZE)] =
+    calc_checksum(&cmd[GHIFP_OPR_OFFSET], UARTCONF_OPR_SIZE);
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+
+  ret = uart_session_write(cmd, UARTCONF_CMD_SIZE);
+  if (0 <= ret)
+    {
+      ret = pop_dataframe_timeout(HOST_IF_CH, g_uart_probe_buf,
+                                  UARTCONF_RES_SIZE, &res_len,
+                                  UART_PROBE_TIMEOUT_MS);
+    }
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
+
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (res_len != UARTCONF_RES_SIZE ||
+      g_uart_probe_buf[GHIFP_OPC_OFFSET] != UARTCONF_OPC ||
+      g_uart_probe_buf[GHIFP_OPR_OFFSET] != GHIFP_STDERR_OK)
+    {
+      return -EIO;
+    }
+
+  return 0;
+}
+
+/* Find the rate Gacrux is running at. The default rate after reset is
+ * tried first, then from the fastest one. Two answers in a row are
+ * needed to lock, and the old rate is restored if nothing answers.
+ * Returns the speed number found.
+ */
+
+static int uart_autobaud(void)
+{
+  int     ret;
+  int     i;
+  uint8_t speed;
+  uint8_t old = g_uart_ses.speed_no;
+
+  printf("UART resync start. speed No.%d\n", old);
+
+  for (i=-1; i<=SPEED_UART_MAX; i++)
+    {
+      speed = i < 0 ? UART_DEFAULT_SPEED_NO : SPEED_UART_MAX - i;
+      if (0 <= i && speed == UART_DEFAULT_SPEED_NO)
+        {
+          continue;
+        }
+
+      if (apply_speed(speed) < 0)
+        {
+          continue; /* Not supported by the host */
+        }
+
+      if (uart_probe(speed) == 0 && uart_probe(speed) == 0)
+        {
+          printf("UART resynced. speed No.%d\n", speed);
+          return speed;
+        }
+    }
+
+  printf("UART resync failed, keep speed No.%d\n", old);
+
+  ret = apply_speed(old);
+
+  return ret < 0 ? ret : -ENOLINK;
+}
+
+/* Called by the receive task per header. Only consecutive header errors,
+ * likely a baudrate mismatch with Gacrux, request a resync. A response
+ * timeout alone does not, it is also how a link change being verified
+ * fails, and that is rolled back by its caller.
+ */
+
+static void uart_hdr_result(bool ok)
+{
+  bool lost = false;
+
+  LOCK();
+  if (ok)
+    {
+      g_uart_ses.hdr_err = 0;
+    }
+  else if (++g_uart_ses.hdr_err == UART_RESYNC_HDR_ERR_NUM)
+    {
+      g_uart_ses.resync_req = true;
+      lost = true;
+    }
+  UNLOCK();
+
+  if (lost)
+    {
+      printf("UART link lost, resync before next write.\n");
+    }
+}
+
+/* Recovery is done by the next writer, the receive task cannot wait
+ * for its own responses.
+ */
+
+static void uart_resync_check(void)
+{
+  bool req;
+
+  LOCK();
+  req = g_uart_ses.resync_req;
+  g_uart_ses.resync_req = false;
+  UNLOCK();
+
+  if (req)
+    {
+      uart_autobaud();
+    }
+}
+
+/* UARTCONF changes baudrate and flow control at once, so only keep it
+ * here until change_baudrate().
+ */
+
+static int set_flow_ctrl(uint8_t flow_ctrl)
+{
+#ifdef UART_FLOW_CTRL_SUPPORTED
+  if (flow_ctrl && !g_uart_ses.flow_ctrl)
+    {
+      CXD56_PIN_CONFIGS(PINCONFS_UART2); /* Add CTS and RTS pins */
+    }
+
+  LOCK();
+  g_uart_ses.next_flow_ctrl = flow_ctrl != 0;
+  UNLOCK();
+
+  return 0;
+#else
+  if (flow_ctrl)
+    {
+      printf("RTS/CTS is not enabled in the serial driver.\n");
+      return -ENOTSUP;
+    }
+
+  return 0;
+#endif
+}
+
+static int uart_open(const char *devpath, speed_t baudrate,
+                     bool flow_ctrl)
 {
   int ret;
   int fd;
@@ -349,7 +744,7 @@ static int uart_open(const char *devpath, speed_t baudrate)
       return -errno;
     }
 
-  ret = set_baudrate(fd, baudrate);
+  ret = set_baudrate(fd, baudrate, flow_ctrl);
   if (ret < 0)
     {
       close(fd);
@@ -365,60 +760,303 @@ static int uart_close(int fd)
   return close(fd);
 }
 
-static int host_if_uart_write(
-  FAR struct host_if_s *thiz, FAR uint8_t *data, uint32_t sz)
+/* Called with LOCK held. */
+
+static int uart_session_fd(void)
 {
-  int      ret = -EINVAL;
-  int      fd;
-  uint8_t  opc;
-  uint16_t opr_len;
-  uint32_t total_sz = 0;
+  pid_t pid = getpid();
 
-  printf("host_if_uart_write() len=%ld\n", sz);
+  if (0 <= g_uart_ses.fd && g_uart_ses.pid == pid)
+    {
+      return g_uart_ses.fd;
+    }
 
-  if (!thiz || !data || !sz)
+  /* The old one was closed when its task exited. The port is already
+   * configured, so just open it.
+   */
+
+  g_uart_ses.fd = open(DEV_PATH, O_RDWR);
+  if (g_uart_ses.fd < 0)
     {
-      return ret;
+      return -errno;
     }
 
-  if (0 != check_header(data, &opc, &opr_len))
+  g_uart_ses.pid = pid;
+
+  return g_uart_ses.fd;
+}
+
+/* Queue the data to the TX ring. Blocks only while the ring is full,
+ * so a frame larger than the ring is queued as it drains. LOCK keeps
+ * the frames of writers from interleaving.
+ */
+
+static int uart_session_write(FAR uint8_t *data, uint32_t sz)
+{
+  int      ret;
+  uint32_t n;
+  uint32_t total_sz = 0;
+
+  LOCK();
+  TX_LOCK();
+
+  ret = g_uart_tx.err;
+  g_uart_tx.err = 0;
+  if (ret < 0)
     {
+      printf("UART write error:%d\n", ret);
+      TX_UNLOCK();
+      UNLOCK();
       return ret;
     }
 
-  if (0 != check_data(data + GHIFP_HEADER_SIZE, opr_len))
+  while (total_sz < sz)
     {
-      return ret;
+      while (g_uart_tx.len == UART_TX_RING_SZ)
+        {
+          g_uart_tx.space_wait = true;
+          TX_UNLOCK();
+          sem_wait(&g_uart_tx.space_sem);
+          TX_LOCK();
+        }
+
+      /* Up to the end of the ring or the free space */
+
+      n = UART_TX_RING_SZ - g_uart_tx.head;
+      if (UART_TX_RING_SZ - g_uart_tx.len < n)
+        {
+          n = UART_TX_RING_SZ - g_uart_tx.len;
+        }
+
+      if (sz - total_sz < n)
+        {
+          n = sz - total_sz;
+        }
+
+      memcpy(&g_uart_tx.buf[g_uart_tx.head], data + total_sz, n);
+      g_uart_tx.head = (g_uart_tx.head + n) % UART_TX_RING_SZ;
+      g_uart_tx.len += n;
+      total_sz      += n;
+
+      if (g_uart_tx.data_wait)
+        {
+          g_uart_tx.data_wait = false;
+          sem_post(&g_uart_tx.data_sem);
+        }
     }
 
-  fd = uart_open(DEV_PATH, g_uart_baudrate);
+  TX_UNLOCK();
+  UNLOCK();
+
+  return total_sz;
+}
+
+static int uart_tx_task(int argc, FAR char *argv[])
+{
+  int           ret;
+  int           fd;
+  uint32_t      n;
+  struct pollfd pfd;
+
+  /* Own descriptor, non-blocking so poll() tells when the driver can
+   * take more. The port is configured by the receive task.
+   */
+
+  fd = open(DEV_PATH, O_WRONLY | O_NONBLOCK);
   if (fd < 0)
     {
-      return fd;
+      ret = -errno;
+      printf("Failed to open TX:%d\n", ret);
+      g_uart_tx.err = ret;
+      sem_post(&g_uart_tx.ready_sem);
+      return ret;
     }
 
-  while (total_sz < sz)
+  pfd.fd     = fd;
+  pfd.events = POLLOUT;
+
+  sem_post(&g_uart_tx.ready_sem);
+
+  while (1)
     {
-      ret = write(fd, data + total_sz, (size_t)sz - total_sz);
-      if (ret < 0)
+      TX_LOCK();
+
+      while (g_uart_tx.len == 0)
+        {
+          g_uart_tx.data_wait = true;
+          TX_UNLOCK();
+          sem_wait(&g_uart_tx.data_sem);
+          TX_LOCK();
+        }
+
+      /* Contiguous part only, the rest comes with the next loop */
+
+      n = UART_TX_RING_SZ - g_uart_tx.tail;
+      if (g_uart_tx.len < n)
+        {
+          n = g_uart_tx.len;
+        }
+
+      TX_UNLOCK();
+
+      ret = poll(&pfd, 1, -1);
+      if (0 < ret)
+        {
+          ret = write(fd, &g_uart_tx.buf[g_uart_tx.tail], n);
+        }
+
+      TX_LOCK();
+
+      if (ret < 0 && errno != EAGAIN && errno != EINTR)
         {
-          printf("UART write error:%d\n", ret);
-          break;
+          /* Drop what is queued, the writer sees the error. */
+
+          g_uart_tx.err  = -errno;
+          g_uart_tx.tail = g_uart_tx.head;
+          g_uart_tx.len  = 0;
+        }
+      else if (0 < ret)
+        {
+          g_uart_tx.tail = (g_uart_tx.tail + ret) % UART_TX_RING_SZ;
+          g_uart_tx.len -= ret;
         }
-      total_sz += ret;
+
+      if (g_uart_tx.len == 0 && g_uart_tx.flushing)
+        {
+          g_uart_tx.flushing = false;
+          sem_post(&g_uart_tx.empty_sem);
+        }
+
+      if (g_uart_tx.len < UART_TX_RING_SZ && g_uart_tx.space_wait)
+        {
+          g_uart_tx.space_wait = false;
+          sem_post(&g_uart_tx.space_sem);
+        }
+
+      TX_UNLOCK();
     }
 
-  uart_close(fd);
+  close(fd);
 
-  if (0 < ret)
+  return 0;
+}
+
+/* Wait until everything queued is handed to the driver. */
+
+static void uart_tx_flush(void)
+{
+  TX_LOCK();
+
+  while (g_uart_tx.len != 0)
     {
-      set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
-      return total_sz;
+      g_uart_tx.flushing = true;
+      TX_UNLOCK();
+      sem_wait(&g_uart_tx.empty_sem);
+      TX_LOCK();
     }
-  else
+
+  TX_UNLOCK();
+}
+
+static int uart_tx_init(void)
+{
+  int ret;
+
+  memset(&g_uart_tx, 0, sizeof(struct uart_tx_ring_s));
+
+  g_uart_tx.buf = (FAR uint8_t *)malloc(UART_TX_RING_SZ);
+  if (!g_uart_tx.buf)
+    {
+      return -ENOMEM;
+    }
+
+  pthread_mutex_init(&g_uart_tx.lock, NULL);
+  sem_init(&g_uart_tx.data_sem, 0, 0);
+  sem_init(&g_uart_tx.space_sem, 0, 0);
+  sem_init(&g_uart_tx.empty_sem, 0, 0);
+  sem_init(&g_uart_tx.ready_sem, 0, 0);
+
+  g_uart_tx.pid = start_task("ghifp_uart_tx_task", uart_tx_task, NULL);
+  if (g_uart_tx.pid < 0)
+    {
+      uart_tx_fin();
+      return -EIO;
+    }
+
+  /* Without the task nothing drains the ring, and writers and flushes
+   * would wait for good. So fail here rather than later.
+   */
+
+  while (sem_wait(&g_uart_tx.ready_sem) != 0 && errno == EINTR);
+
+  ret = g_uart_tx.err;
+  if (ret < 0)
+    {
+      g_uart_tx.pid = 0; /* Already exited */
+      uart_tx_fin();
+      return ret;
+    }
+
+  return 0;
+}
+
+static void uart_tx_fin(void)
+{
+  if (0 < g_uart_tx.pid)
+    {
+      stop_task(g_uart_tx.pid);
+    }
+
+  if (g_uart_tx.buf)
+    {
+      sem_destroy(&g_uart_tx.ready_sem);
+      sem_destroy(&g_uart_tx.empty_sem);
+      sem_destroy(&g_uart_tx.space_sem);
+      sem_destroy(&g_uart_tx.data_sem);
+      pthread_mutex_destroy(&g_uart_tx.lock);
+      free(g_uart_tx.buf);
+    }
+
+  memset(&g_uart_tx, 0, sizeof(struct uart_tx_ring_s));
+}
+
+static int host_if_uart_write(
+  FAR struct host_if_s *thiz, FAR uint8_t *data, uint32_t sz)
+{
+  int      ret = -EINVAL;
+  uint8_t  opc;
+  uint16_t opr_len;
+
+  HIF_DBG("host_if_uart_write() len=%ld\n", sz);
+
+  if (!thiz || !data || !sz)
+    {
+      return ret;
+    }
+
+  if (0 != check_header(data, &opc, &opr_len))
     {
       return ret;
     }
+
+  if (0 != check_data(data + GHIFP_HEADER_SIZE, opr_len))
+    {
+      return ret;
+    }
+
+  uart_resync_check();
+
+  /* Wait for the response before it can arrive. */
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+
+  ret = uart_session_write(data, sz);
+  if (ret < 0)
+    {
+      set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
+    }
+
+  return ret;
 }
 
 static int host_if_uart_read(
@@ -427,15 +1065,15 @@ static int host_if_uart_read(
   int      ret = -EINVAL;
   uint32_t res_len;
 
-  printf("host_if_uart_read() buflen=%ld\n", sz);
+  HIF_DBG("host_if_uart_read() buflen=%ld\n", sz);
 
   if (!thiz || !buf || !sz)
     {
       return ret;
     }
 
-  ret = pop_dataframe(buf, sz, &res_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, sz, &res_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
@@ -443,7 +1081,7 @@ static int host_if_uart_read(
     }
   else
     {
-      printf("Response dataframe len:%ld\n", res_len);
+      HIF_DBG("Response dataframe len:%ld\n", res_len);
       return res_len;
     }
 }
@@ -455,13 +1093,11 @@ static int host_if_uart_transaction(
   FAR uint32_t *res_len)
 {
   int      ret = -EINVAL;
-  int      fd;
   uint32_t df_len;
   uint8_t  opc;
   uint16_t opr_len;
-  uint32_t total_sz = 0;
 
-  printf("UART transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
+  HIF_DBG("UART transaction. write len=%ld, read len=%ld\n", w_sz, r_sz);
 
   if (!thiz || !data || !w_sz || !buf || !r_sz || !res_len)
     {
@@ -478,40 +1114,31 @@ static int host_if_uart_transaction(
       return ret;
     }
 
-  fd = uart_open(DEV_PATH, g_uart_baudrate);
-  if (fd < 0)
-    {
-      return fd;
-    }
+  uart_resync_check();
 
-  while (total_sz < w_sz)
+  /* Wait for the response before it can arrive. */
+
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_WAIT_RESPONSE);
+
+  ret = uart_session_write(data, w_sz);
+  if (ret < 0)
     {
-      ret = write(fd, data + total_sz, (size_t)w_sz - total_sz);
-      if (ret < 0)
-        {
-          printf("UART write error:%d\n", ret);
-          goto exit;
-        }
-      total_sz += ret;
+      set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
+      return ret;
     }
-  set_host_if_state(HOST_IF_STATE_WAIT_RESPONSE);
 
-  ret = pop_dataframe(buf, r_sz, &df_len);
-  set_host_if_state(HOST_IF_STATE_IDLE);
+  ret = pop_dataframe(HOST_IF_CH, buf, r_sz, &df_len);
+  set_host_if_state(HOST_IF_CH, HOST_IF_STATE_IDLE);
   if (ret < 0)
     {
       printf("Response pop error:%d\n", ret);
-      goto exit;
     }
   else
     {
-      printf("Response dataframe len:%ld\n", df_len);
+      HIF_DBG("Response dataframe len:%ld\n", df_len);
       *res_len = df_len;
     }
 
-exit:
-  uart_close(fd);
-
   return ret;
 }
 
@@ -519,36 +1146,15 @@ static int host_if_uart_dbg_write(
   FAR struct host_if_s *thiz, FAR uint8_t *data, uint32_t sz)
 {
   int      ret = -EINVAL;
-  int      fd;
-  uint32_t total_sz = 0;
 
-  printf("host_if_uart_dbg_write() len=%ld\n", sz);
+  HIF_DBG("host_if_uart_dbg_write() len=%ld\n", sz);
 
   if (!thiz || !data || !sz)
     {
       return ret;
     }
 
-  fd = uart_open(DEV_PATH, g_uart_baudrate);
-  if (fd < 0)
-    {
-      return fd;
-    }
-
-  while (total_sz < sz)
-    {
-      ret = write(fd, data + total_sz, (size_t)sz - total_sz);
-      if (ret < 0)
-        {
-          printf("UART write error:%d\n", ret);
-          break;
-        }
-      total_sz += ret;
-    }
-
-  uart_close(fd);
-
-  return ret < 0 ? ret : total_sz;
+  return uart_session_write(data, sz);
 }
 
 static int host_if_uart_set_config(
@@ -577,6 +1183,25 @@ static int host_if_uart_set_config(
       case HOST_IF_SET_CONFIG_REQ_SETSLVCONF:
         ret = change_baudrate(*(uint8_t *)arg);
         break;
+      case HOST_IF_SET_CONFIG_REQ_SETFLOWCTRL:
+        ret = set_flow_ctrl(*(uint8_t *)arg);
+        break;
+      case HOST_IF_SET_CONFIG_REQ_GETSLVCONF:
+        ((FAR uint8_t *)arg)[0] = g_uart_ses.speed_no;
+        ((FAR uint8_t *)arg)[1] = g_uart_ses.flow_ctrl;
+        ret = 0;
+        break;
+      case HOST_IF_SET_CONFIG_REQ_RESYNC:
+        LOCK();
+        g_uart_ses.resync_req = false;
+        UNLOCK();
+        ret = uart_autobaud();
+        if (0 <= ret)
+          {
+            *(uint8_t *)arg = (uint8_t)ret; /* Speed No found */
+            ret = 0;
+          }
+        break;
       default:
         printf("Nothing to do in UART mode.\n");
         break;
@@ -592,13 +1217,27 @@ FAR struct host_if_s *host_if_uart_create(hostif_evt_cb evt_cb)
 {
   if (!evt_cb)
     {
-      goto errout;
+      return NULL;
     }
   else
     {
       g_evt_cb = evt_cb;
     }
 
+  if (pthread_mutex_init(&g_uart_ses.lock, NULL) != 0)
+    {
+      return NULL;
+    }
+
+  g_uart_ses.baudrate       = UART_DEFAULT_BAUDRATE;
+  g_uart_ses.speed_no       = UART_DEFAULT_SPEED_NO;
+  g_uart_ses.hdr_err        = 0;
+  g_uart_ses.resync_req     = false;
+  g_uart_ses.fd             = -1;
+  g_uart_ses.pid            = 0;
+  g_uart_ses.flow_ctrl      = false;
+  g_uart_ses.next_flow_ctrl = false;
+
   g_uart_recv_buf = (FAR uint8_t *)malloc(LOCAL_BUFF_SZ);
   if (!g_uart_recv_buf)
     {
@@ -611,6 +1250,15 @@ FAR struct host_if_s *host_if_uart_create(hostif_evt_cb evt_cb)
       goto errout;
     }
 
+  /* After the receive task, which configures the port */
+
+  if (uart_tx_init() < 0)
+    {
+      stop_task(g_uart_task_pid);
+      g_uart_task_pid = 0;
+      goto errout;
+    }
+
   return &g_uart;
 
 errout:
@@ -621,14 +1269,29 @@ errout:
     }
   g_uart_recv_buf = NULL;
 
+  pthread_mutex_destroy(&g_uart_ses.lock);
+
   return NULL;
 }
 
 int host_if_uart_delete(FAR struct host_if_s *this)
 {
+  uart_tx_flush();
+  uart_tx_fin();
+
   stop_task(g_uart_task_pid);
   g_uart_task_pid = 0;
 
+  LOCK();
+  if (0 <= g_uart_ses.fd && g_uart_ses.pid == getpid())
+    {
+      uart_close(g_uart_ses.fd);
+    }
+  g_uart_ses.fd = -1;
+  UNLOCK();
+
+  pthread_mutex_destroy(&g_uart_ses.lock);
+
   if (g_uart_recv_buf)
     {
       free(g_uart_recv_buf);